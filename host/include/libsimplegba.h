@@ -0,0 +1,201 @@
+/* Copyright 2023 Vulcalien
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+// Host (Linux) replacement for the subset of libsimplegba used by the
+// simulation core. Video memory and the backup chip are plain arrays,
+// so the game code can run unchanged.
+
+#ifndef LIBSIMPLEGBA_HOST
+#define LIBSIMPLEGBA_HOST
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+typedef uint8_t  u8;
+typedef uint16_t u16;
+typedef uint32_t u32;
+typedef int8_t   i8;
+typedef int16_t  i16;
+typedef int32_t  i32;
+
+typedef volatile u8  vu8;
+typedef volatile u16 vu16;
+typedef volatile u32 vu32;
+typedef volatile i8  vi8;
+typedef volatile i16 vi16;
+typedef volatile i32 vi32;
+
+#define static_assert _Static_assert
+
+#define INLINE    inline __attribute__((always_inline))
+#define NO_INLINE __attribute__((noinline))
+
+#define ARM
+#define THUMB
+#define IWRAM_SECTION
+#define EWRAM_SECTION
+#define SBSS_SECTION
+#define IWRAM_RODATA_SECTION
+
+#define DISPLAY_WIDTH  (240)
+#define DISPLAY_HEIGHT (160)
+
+// display
+extern vu16 *display_charblock(u32 block);
+extern vu16 *display_screenblock(u32 block);
+extern void display_config(u32 mode);
+extern void display_force_blank(bool flag);
+extern u16 display_vcount(void);
+extern void display_brighten(void *layers, u32 val);
+extern void display_disable_effects(void);
+
+// backgrounds
+#define BG0 (0)
+#define BG1 (1)
+#define BG2 (2)
+#define BG3 (3)
+
+struct Background {
+    u8 priority;
+    u8 tileset;
+    u8 mosaic;
+    u8 colors;
+    u8 tilemap;
+    u8 size;
+};
+
+extern void background_config(u32 id, const struct Background *config);
+extern void background_toggle(u32 id, bool enable);
+extern void background_offset(u32 id, u16 x, u16 y);
+
+// windows
+#define WINDOW_0   (0)
+#define WINDOW_1   (1)
+#define WINDOW_OUT (2)
+#define WINDOW_SPR (3)
+
+struct Window {
+    bool bg0, bg1, bg2, bg3;
+    bool sprites;
+    bool effects;
+};
+
+extern void window_config(u32 id, const struct Window *config);
+extern void window_toggle(u32 id, bool enable);
+extern void window_viewport(u32 id, u32 x, u32 y, u32 w, u32 h);
+
+// sprites
+#define SPRITE_COUNT (128)
+
+// shape << 2 | size, as in the OAM attributes
+#define SPRITE_SIZE_8x8   (0)
+#define SPRITE_SIZE_16x16 (1)
+#define SPRITE_SIZE_32x32 (2)
+#define SPRITE_SIZE_64x64 (3)
+#define SPRITE_SIZE_16x8  (4)
+#define SPRITE_SIZE_32x8  (5)
+#define SPRITE_SIZE_32x16 (6)
+#define SPRITE_SIZE_64x32 (7)
+#define SPRITE_SIZE_8x16  (8)
+#define SPRITE_SIZE_8x32  (9)
+#define SPRITE_SIZE_16x32 (10)
+#define SPRITE_SIZE_32x64 (11)
+
+struct Sprite {
+    u16 x;
+    u16 y;
+
+    u8 disable;
+    u8 mode;
+    u8 mosaic;
+    u8 colors;
+    u8 size;
+
+    u8 flip;
+    u8 affine_parameter;
+
+    u16 tile;
+    u8 priority;
+    u8 palette;
+};
+
+extern void sprite_config(u32 id, const struct Sprite *sprite);
+extern void sprite_hide(i32 id);
+extern void sprite_hide_range(u32 start, u32 end);
+
+// input
+#define KEY_A      (1 << 0)
+#define KEY_B      (1 << 1)
+#define KEY_SELECT (1 << 2)
+#define KEY_START  (1 << 3)
+#define KEY_RIGHT  (1 << 4)
+#define KEY_LEFT   (1 << 5)
+#define KEY_UP     (1 << 6)
+#define KEY_DOWN   (1 << 7)
+#define KEY_R      (1 << 8)
+#define KEY_L      (1 << 9)
+
+extern void input_init(u32 repeat_delay, u32 repeat_interval);
+extern void input_update(void);
+extern bool input_down(u16 key);
+extern bool input_press(u16 key);
+extern bool input_release(u16 key);
+extern bool input_repeat(u16 key);
+
+// interrupts
+#define IRQ_VBLANK (0)
+#define IRQ_HBLANK (1)
+#define IRQ_VCOUNT (2)
+
+extern void interrupt_toggle(u32 irq, bool enable);
+extern void interrupt_set_isr(u32 irq, void (*isr)(void));
+extern void interrupt_wait(u32 irq);
+
+// audio
+#define AUDIO_BASIC (0)
+
+extern void audio_init(u32 mode);
+extern void audio_update(void);
+extern bool audio_play(i32 channel, const i8 *sound, u32 length);
+
+// backup
+#define BACKUP_FLASH (0)
+
+extern void backup_init(u32 type);
+extern void backup_set_bank(u32 bank);
+extern u8 backup_read_byte(u16 offset);
+extern void backup_read(u16 offset, void *buffer, u32 n);
+extern void backup_write_byte(u16 offset, u8 byte);
+extern void backup_write(u16 offset, const void *buffer, u32 n);
+extern void backup_erase_chip(void);
+
+// memory
+extern void memory_copy_32(volatile void *dest, const volatile void *src,
+                           u32 n);
+extern void memory_set_32(volatile void *dest, u32 byte, u32 n);
+
+// math
+#define math_brad(x) ((x) * 0x8000 / 180)
+extern i32 math_sin(u16 angle);
+extern i32 math_cos(u16 angle);
+
+// random
+#define RANDOM_MAX (0x7fff)
+extern u16 random(u32 bound);
+extern u32 random_seed(u32 seed);
+
+#endif // LIBSIMPLEGBA_HOST
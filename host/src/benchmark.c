@@ -0,0 +1,252 @@
+/* Copyright 2023 Vulcalien
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+// Generates a seeded world, then ticks and draws one of its levels and
+// saves and loads it, reporting how long each part takes.
+//
+// usage: benchmark [seed] [thousands of ticks] [level]
+
+#include "minicraft.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+#include "level.h"
+#include "entity.h"
+#include "mob.h"
+#include "player.h"
+#include "generator.h"
+#include "storage.h"
+#include "performance.h"
+
+static const char * const entity_names[ENTITY_TYPES] = {
+    "zombie", "slime", "air wizard", "player",
+    "workbench", "furnace", "oven", "anvil", "chest", "lantern",
+    "item", "spark",
+    "text particle", "smash particle"
+};
+
+static u64 entity_tick_ns[ENTITY_TYPES];
+static u64 entity_draw_ns[ENTITY_TYPES];
+
+static u64 tick_tiles_ns;
+static u64 draw_tiles_ns;
+static u64 lava_light_ns;
+static u64 sort_ns;
+
+static struct Level saved_levels[5];
+
+static double now(void) {
+    struct timespec t;
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    return t.tv_sec + t.tv_nsec / 1e9;
+}
+
+// move the performance counters into the 64-bit totals
+static void collect_counters(void) {
+    for(u32 i = 0; i < ENTITY_TYPES; i++) {
+        entity_tick_ns[i] += performance_entity_tick_cycles[i];
+        entity_draw_ns[i] += performance_entity_draw_cycles[i];
+
+        performance_entity_tick_cycles[i] = 0;
+        performance_entity_draw_cycles[i] = 0;
+    }
+
+    tick_tiles_ns += performance_tick_tiles_cycles;
+    draw_tiles_ns += performance_draw_tiles_cycles;
+    lava_light_ns += performance_lava_light_cycles;
+    sort_ns       += performance_sort_cycles;
+
+    performance_tick_tiles_cycles = 0;
+    performance_draw_tiles_cycles = 0;
+    performance_lava_light_cycles = 0;
+    performance_sort_cycles = 0;
+}
+
+static u32 level_hash(struct Level *level) {
+    u32 hash = 0;
+    for(u32 i = 0; i < LEVEL_W * LEVEL_H; i++)
+        hash = hash * 31 + level->tiles[i] * 7 + level->data[i];
+
+    for(u32 i = 0; i < ENTITY_LIMIT; i++) {
+        struct entity_Data *data = &level->entities[i];
+        hash = hash * 31 + data->type * 3 + data->x + data->y * 5;
+    }
+    return hash;
+}
+
+#define LOOP_PASSES (100000)
+
+// sum of the visited entities, so that the loops are not optimized out
+static volatile u32 loop_sink;
+
+// A pass over the entities of the level, as the loops of 'level_tick'
+// did before the live entity list: all the slots, skipping empty ones.
+static double time_slots_loop(struct Level *level) {
+    double t0 = now();
+    for(u32 p = 0; p < LOOP_PASSES; p++) {
+        u32 sum = 0;
+        for(u32 i = 0; i < ENTITY_LIMIT; i++) {
+            struct entity_Data *data = &level->entities[i];
+            if(data->type >= ENTITY_TYPES)
+                continue;
+
+            sum += data->x + data->y;
+        }
+        loop_sink = sum;
+    }
+    return (now() - t0) * 1e9 / LOOP_PASSES;
+}
+
+// the same pass over the live entity list
+static double time_live_loop(struct Level *level) {
+    double t0 = now();
+    for(u32 p = 0; p < LOOP_PASSES; p++) {
+        u32 sum = 0;
+        for(u32 l = 0; l < level_live_entity_count; l++) {
+            struct entity_Data *data = &level->entities[level_live_entities[l]];
+
+            sum += data->x + data->y;
+        }
+        loop_sink = sum;
+    }
+    return (now() - t0) * 1e9 / LOOP_PASSES;
+}
+
+static void print_phase(const char *name, u64 ns, u32 samples) {
+    if(ns != 0)
+        printf("  %-16s %10.0f ns\n", name, (double) ns / samples);
+}
+
+int main(int argc, char **argv) {
+    u32 seed = 1;
+    u32 ticks = 10;
+    u32 level_index = 3;
+
+    if(argc > 1) sscanf(argv[1], "%u", &seed);
+    if(argc > 2) sscanf(argv[2], "%u", &ticks);
+    if(argc > 3) sscanf(argv[3], "%u", &level_index);
+
+    ticks *= 1000;
+    if(level_index >= 5)
+        level_index = 3;
+
+    // generate
+    double t0 = now();
+    random_seed(seed);
+    generate_levels();
+    double generate_time = now() - t0;
+
+    current_level = level_index;
+    struct Level *level = &levels[level_index];
+
+    // the player is generated in the surface: move it, as the game does
+    if(level_index != 3) {
+        level->entities[0] = levels[3].entities[0];
+        level->entities[0].x = (level->entities[0].x & 0xfff0) + 8;
+        level->entities[0].y = (level->entities[0].y & 0xfff0) + 8;
+    }
+
+    t0 = now();
+    level_load(level);
+    double load_time = now() - t0;
+
+    // tick and draw
+    struct mob_Data *player_mob_data =
+        (struct mob_Data *) &level->entities[0].data;
+
+    collect_counters();
+    memset(entity_tick_ns, 0, sizeof(entity_tick_ns));
+    memset(entity_draw_ns, 0, sizeof(entity_draw_ns));
+    tick_tiles_ns = draw_tiles_ns = lava_light_ns = sort_ns = 0;
+
+    u64 level_tick_ns = 0;
+    t0 = now();
+    for(u32 i = 0; i < ticks; i++) {
+        level_tick(level);
+        level_draw(level);
+
+        level_tick_ns += performance_level_tick_cycles;
+        collect_counters();
+
+        // keep the player alive, so that mobs keep spawning around it
+        if(level->entities[0].type == PLAYER_ENTITY)
+            player_mob_data->hp = 10; // MAX_HP
+
+        tick_count++;
+        gametime++;
+    }
+    double run_time = now() - t0;
+
+    // entity loops, on the entities left after the run
+    const double slots_loop_ns = time_slots_loop(level);
+    const double live_loop_ns  = time_live_loop(level);
+
+    // save and load
+    memcpy(saved_levels, levels, sizeof(levels));
+
+    t0 = now();
+    storage_save();
+    double save_time = now() - t0;
+
+    memset(levels, 0, sizeof(levels));
+
+    t0 = now();
+    storage_load();
+    double storage_load_time = now() - t0;
+
+    bool same_tiles = true;
+    for(u32 l = 0; l < 5; l++) {
+        if(memcmp(levels[l].tiles, saved_levels[l].tiles, LEVEL_W * LEVEL_H) ||
+           memcmp(levels[l].data,  saved_levels[l].data,  LEVEL_W * LEVEL_H))
+            same_tiles = false;
+    }
+
+    // report
+    printf("seed %u, level %u, %u ticks\n", seed, level_index, ticks);
+    printf("generate_levels  %10.2f ms\n", generate_time * 1e3);
+    for(u32 l = 0; l < 5; l++) {
+        printf("  level %u        %10.2f ms (%u attempts)\n",
+               l, generator_cycles[l] / 1e6, generator_attempts[l]);
+    }
+    printf("level_load       %10.2f ms\n", load_time * 1e3);
+    printf("tick + draw      %10.0f ticks/s\n", ticks / run_time);
+    printf("storage_save     %10.2f ms\n", save_time * 1e3);
+    printf("storage_load     %10.2f ms (%s)\n", storage_load_time * 1e3,
+           same_tiles ? "tiles match" : "TILES DIFFER");
+
+    printf("entities %u, state %08x\n",
+           level_live_entity_count, level_hash(&saved_levels[level_index]));
+
+    printf("entity loop      %10.0f ns all slots, %.0f ns live list\n",
+           slots_loop_ns, live_loop_ns);
+
+    printf("average per tick:\n");
+    print_phase("level_tick", level_tick_ns, ticks);
+    print_phase("tick_tiles", tick_tiles_ns, ticks);
+    for(u32 i = 0; i < ENTITY_TYPES; i++)
+        print_phase(entity_names[i], entity_tick_ns[i], ticks);
+
+    printf("average per frame:\n");
+    print_phase("draw_tiles", draw_tiles_ns, ticks);
+    print_phase("sort_entities", sort_ns, ticks);
+    print_phase("draw_lava_light", lava_light_ns, ticks);
+    for(u32 i = 0; i < ENTITY_TYPES; i++)
+        print_phase(entity_names[i], entity_draw_ns[i], ticks);
+
+    return !same_tiles;
+}
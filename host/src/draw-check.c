@@ -0,0 +1,337 @@
+/* Copyright 2023 Vulcalien
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+// Checks the incremental drawing of the level against the routines it
+// replaced, on generated worlds: the camera moves and teleports, ticks
+// are skipped and tiles are edited around it. After each draw:
+//   - the tile masks must match the masks computed from the tiles
+//   - the visible part of the BG1 ring buffer must match the tiles drawn
+//     from scratch
+//   - the light layer must match the one drawn by searching the liquid
+//     tiles around the camera, as 'draw_lava_light' used to do, and by
+//     lighting every lantern of the level, as 'draw_entities' used to do
+// Level 0 also checks that computing the lava light by rows, in any
+// order, gives the same light map as computing it at once. Levels are
+// loaded step by step, drawing between the steps.
+//
+// usage: draw-check [number of seeds] [frames per level]
+
+#include "../../src/level.c"
+
+#include <stdio.h>
+#include <string.h>
+
+#include "generator.h"
+#include "furniture.h"
+#include "item.h"
+
+static u32 check_seed = 1;
+
+// the generator of libsimplegba is not used: the game uses it while
+// drawing (e.g. sparks), so it must keep the same sequence
+static u32 check_random(u32 bound) {
+    check_seed = check_seed * 1103515245 + 12345;
+    return (check_seed >> 16) % bound;
+}
+
+static bool check_masks(struct Level *level) {
+    for(u32 yt = 0; yt < LEVEL_H; yt++) {
+        for(u32 xt = 0; xt < LEVEL_W; xt++) {
+            if(tile_masks[xt + yt * LEVEL_W] != get_tile_mask(level, xt, yt)) {
+                printf("tile mask differs at %u, %u\n", xt, yt);
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+// the visible tiles, drawn from scratch as 'draw_tiles' used to do
+static bool check_tilemap(struct Level *level) {
+    const u32 x0 = level_x_offset >> 4;
+    const u32 y0 = level_y_offset >> 4;
+
+    const vu16 *tilemap = BG1_TILEMAP;
+    for(u32 y = 0; y < VISIBLE_TILES_H; y++) {
+        for(u32 x = 0; x < VISIBLE_TILES_W; x++) {
+            u16 tiles[4] = { 0 };
+            draw_tile(level, x0 + x, y0 + y, tiles);
+
+            const u32 xr = (x0 + x) % TILEMAP_RING_SIZE;
+            const u32 yr = (y0 + y) % TILEMAP_RING_SIZE;
+            const vu16 *entry = &tilemap[xr * 2 + yr * 2 * 32];
+
+            if(entry[0]  != tiles[0] || entry[1]  != tiles[1] ||
+               entry[32] != tiles[2] || entry[33] != tiles[3]) {
+                printf("BG1 differs at tile %u, %u\n", x0 + x, y0 + y);
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+static u16 reference_light[32 * 20];
+
+static inline void stamp_reference_light(i32 xr, i32 yr, i32 radius,
+                                         u32 limit1, u32 limit2) {
+    i32 xl0 = xr - radius;
+    i32 yl0 = yr - radius;
+    i32 xl1 = xr + radius;
+    i32 yl1 = yr + radius;
+
+    if(xl1 < 0 || yl1 < 0)
+        return;
+
+    if(xl0 < 0) xl0 = 0;
+    if(yl0 < 0) yl0 = 0;
+    if(xl1 > 32) xl1 = 32;
+    if(yl1 > 20) yl1 = 20;
+
+    for(i32 yl = yl0; yl < yl1; yl++) {
+        u32 yd = (yl - yr + (yl >= yr)) * (yl - yr + (yl >= yr));
+
+        for(i32 xl = xl0; xl < xl1; xl++) {
+            u32 xd = (xl - xr + (xl >= xr)) * (xl - xr + (xl >= xr));
+
+            u32 val = 192 + (xd + yd <= limit1) + (xd + yd <= limit2);
+            if(reference_light[xl + yl * 32] < val)
+                reference_light[xl + yl * 32] = val;
+        }
+    }
+}
+
+static void draw_reference_lava_light(struct Level *level) {
+    const u32 x0 = level_x_offset >> 4;
+    const u32 y0 = level_y_offset >> 4;
+
+    for(i32 y = -2; y < 10 + 2; y++) {
+        for(i32 x = -2; x < 16 + 2; x++) {
+            if(LEVEL_GET_TILE(level, x0 + x, y0 + y) != LIQUID_TILE)
+                continue;
+
+            if((x0 + x) & 1 &&
+               LEVEL_GET_TILE(level, x0 + x - 1, y0 + y) == LIQUID_TILE &&
+               LEVEL_GET_TILE(level, x0 + x + 1, y0 + y) == LIQUID_TILE)
+                continue;
+
+            if((y0 + y) & 1 &&
+               LEVEL_GET_TILE(level, x0 + x, y0 + y - 1) == LIQUID_TILE &&
+               LEVEL_GET_TILE(level, x0 + x, y0 + y + 1) == LIQUID_TILE)
+                continue;
+
+            stamp_reference_light(x * 2 + 1, y * 2 + 1, 5, 34, 24);
+        }
+    }
+}
+
+static bool check_light(struct Level *level) {
+    if(level >= &levels[3])
+        return true;
+
+    for(u32 i = 0; i < 32 * 20; i++)
+        reference_light[i] = 192;
+
+    if(level == &levels[0])
+        draw_reference_lava_light(level);
+
+    for(u32 i = 0; i < ENTITY_LIMIT; i++) {
+        struct entity_Data *data = &level->entities[i];
+        if(data->type != LANTERN_ENTITY)
+            continue;
+
+        const i32 xr = ((data->x + 4) >> 3) - ((level_x_offset >> 3) & ~1);
+        const i32 yr = ((data->y + 4) >> 3) - ((level_y_offset >> 3) & ~1);
+        stamp_reference_light(xr, yr, 7, 66, 46);
+    }
+
+    const u16 *light = (const u16 *) light_buffer;
+    for(u32 i = 0; i < 32 * 20; i++) {
+        if(light[i] != reference_light[i]) {
+            printf("light differs at cell %u, %u\n", i % 32, i / 32);
+            return false;
+        }
+    }
+    return true;
+}
+
+static u8 full_light_map[sizeof(lava_light_map)];
+
+// computes the light map again, by bands of rows in a random order
+static bool check_lava_light_rows(struct Level *level) {
+    memcpy(full_light_map, lava_light_map, sizeof(lava_light_map));
+
+    const u32 band = 1 + check_random(16);
+    const u32 bands = (LEVEL_H + band - 1) / band;
+
+    u8 order[LEVEL_H];
+    for(u32 i = 0; i < bands; i++)
+        order[i] = i;
+    for(u32 i = bands - 1; i > 0; i--) {
+        const u32 j = check_random(i + 1);
+        const u8 tmp = order[i];
+        order[i] = order[j];
+        order[j] = tmp;
+    }
+
+    memset(lava_light_map, 0x55, sizeof(lava_light_map));
+    for(u32 i = 0; i < bands; i++) {
+        const u32 y0 = order[i] * band;
+        const u32 y1 = (y0 + band < LEVEL_H) ? y0 + band : LEVEL_H;
+        load_lava_light(level, y0, y1);
+    }
+
+    if(memcmp(full_light_map, lava_light_map, sizeof(lava_light_map))) {
+        printf("the light map computed by rows differs (bands of %u)\n", band);
+        return false;
+    }
+    return true;
+}
+
+static const u8 edit_tiles[] = {
+    GRASS_TILE, ROCK_TILE, LIQUID_TILE, DIRT_TILE,
+    SAND_TILE, HOLE_TILE, TREE_TILE, FLOWER_TILE
+};
+
+static void edit_around_camera(struct Level *level) {
+    // sometimes, more tiles change than the dirty list can hold
+    const u32 edits = check_random(20) == 0 ? 80 : check_random(4);
+
+    for(u32 i = 0; i < edits; i++) {
+        const i32 xt = (level_x_offset >> 4) - 3 + check_random(22);
+        const i32 yt = (level_y_offset >> 4) - 3 + check_random(16);
+        const u8 tile = edit_tiles[check_random(sizeof(edit_tiles))];
+
+        LEVEL_SET_TILE(level, xt, yt, tile, 0);
+    }
+}
+
+#define LANTERN_LIMIT (100)
+
+static u32 lantern_count;
+
+// places lanterns around the camera, in the levels that have light
+static void add_lanterns(struct Level *level) {
+    if(level >= &levels[3])
+        return;
+
+    struct item_Data lantern = { .type = LANTERN_ITEM };
+
+    const u32 count = check_random(21);
+    for(u32 i = 0; i < count && lantern_count < LANTERN_LIMIT; i++) {
+        const i32 xt = (level_x_offset >> 4) - 12 + check_random(40);
+        const i32 yt = (level_y_offset >> 4) - 12 + check_random(34);
+        if(xt < 0 || xt >= LEVEL_W || yt < 0 || yt >= LEVEL_H)
+            continue;
+
+        if(entity_add_furniture(level, xt, yt, &lantern))
+            lantern_count++;
+    }
+}
+
+static void move_camera(struct Level *level) {
+    struct entity_Data *player = &level->entities[0];
+
+    if(check_random(30) == 0) {
+        player->x = 16 + check_random((LEVEL_W - 2) * 16);
+        player->y = 16 + check_random((LEVEL_H - 2) * 16);
+
+        add_lanterns(level);
+    } else {
+        player->x += check_random(49) - 24;
+        player->y += check_random(49) - 24;
+
+        if(player->x < 16) player->x = 16;
+        if(player->y < 16) player->y = 16;
+        if(player->x >= (LEVEL_W - 1) * 16) player->x = (LEVEL_W - 1) * 16 - 1;
+        if(player->y >= (LEVEL_H - 1) * 16) player->y = (LEVEL_H - 1) * 16 - 1;
+    }
+}
+
+static bool check_level(u32 seed, u32 level_index, u32 frames) {
+    random_seed(seed);
+    generate_levels();
+
+    current_level = level_index;
+    struct Level *level = &levels[level_index];
+
+    // the player is generated in the surface
+    if(level_index != 3)
+        level->entities[0] = levels[3].entities[0];
+
+    // load as the stair transition does, drawing between the steps
+    level_load_begin(level);
+
+    level_draw(level);
+    if(tilemap_valid) {
+        printf("the level was drawn before its visible rows were loaded\n");
+        return false;
+    }
+
+    while(!level_load_step()) {
+        level_draw(level);
+        if(are_visible_rows_loaded() &&
+           (!check_tilemap(level) || !check_light(level)))
+            return false;
+    }
+    if(!check_masks(level))
+        return false;
+
+    if(level == &levels[0] && !check_lava_light_rows(level))
+        return false;
+
+    lantern_count = 0;
+    add_lanterns(level);
+
+    for(u32 f = 0; f < frames; f++) {
+        move_camera(level);
+        edit_around_camera(level);
+
+        // skipped ticks change the animation of liquid tiles
+        tick_count += 1 + check_random(12);
+
+        level_draw(level);
+
+        if(!check_masks(level) || !check_tilemap(level) ||
+           !check_light(level))
+            return false;
+    }
+
+    // the light map after the edits
+    if(level == &levels[0] && !check_lava_light_rows(level))
+        return false;
+    return true;
+}
+
+int main(int argc, char **argv) {
+    u32 seeds = 10;
+    u32 frames = 1000;
+
+    if(argc > 1) sscanf(argv[1], "%u", &seeds);
+    if(argc > 2) sscanf(argv[2], "%u", &frames);
+
+    for(u32 seed = 1; seed <= seeds; seed++) {
+        for(u32 l = 0; l < 5; l++) {
+            check_seed = seed;
+            if(!check_level(seed, l, frames)) {
+                printf("seed %u, level %u: FAILED\n", seed, l);
+                return 1;
+            }
+        }
+    }
+    printf("%u seeds, %u frames per level: OK\n", seeds, frames);
+    return 0;
+}
@@ -0,0 +1,179 @@
+/* Copyright 2023 Vulcalien
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+#include <libsimplegba.h>
+
+#include <math.h>
+#include <string.h>
+
+// VRAM, so that the tilemaps written by the game are valid memory
+static u16 vram[0x18000 / 2];
+
+vu16 *display_charblock(u32 block) {
+    return &vram[block * 0x4000 / 2];
+}
+
+vu16 *display_screenblock(u32 block) {
+    return &vram[block * 0x800 / 2];
+}
+
+void display_config(u32 mode) {
+}
+
+void display_force_blank(bool flag) {
+}
+
+u16 display_vcount(void) {
+    return 0;
+}
+
+void display_brighten(void *layers, u32 val) {
+}
+
+void display_disable_effects(void) {
+}
+
+void background_config(u32 id, const struct Background *config) {
+}
+
+void background_toggle(u32 id, bool enable) {
+}
+
+void background_offset(u32 id, u16 x, u16 y) {
+}
+
+void window_config(u32 id, const struct Window *config) {
+}
+
+void window_toggle(u32 id, bool enable) {
+}
+
+void window_viewport(u32 id, u32 x, u32 y, u32 w, u32 h) {
+}
+
+void sprite_config(u32 id, const struct Sprite *sprite) {
+}
+
+void sprite_hide(i32 id) {
+}
+
+void sprite_hide_range(u32 start, u32 end) {
+}
+
+void input_init(u32 repeat_delay, u32 repeat_interval) {
+}
+
+void input_update(void) {
+}
+
+bool input_down(u16 key) {
+    return false;
+}
+
+bool input_press(u16 key) {
+    return false;
+}
+
+bool input_release(u16 key) {
+    return false;
+}
+
+bool input_repeat(u16 key) {
+    return false;
+}
+
+void interrupt_toggle(u32 irq, bool enable) {
+}
+
+void interrupt_set_isr(u32 irq, void (*isr)(void)) {
+}
+
+void interrupt_wait(u32 irq) {
+}
+
+void audio_init(u32 mode) {
+}
+
+void audio_update(void) {
+}
+
+bool audio_play(i32 channel, const i8 *sound, u32 length) {
+    return true;
+}
+
+// 128 KB flash, in two 64 KB banks
+static u8 backup[2][0x10000];
+static u32 backup_bank;
+
+void backup_init(u32 type) {
+}
+
+void backup_set_bank(u32 bank) {
+    backup_bank = bank;
+}
+
+u8 backup_read_byte(u16 offset) {
+    return backup[backup_bank][offset];
+}
+
+void backup_read(u16 offset, void *buffer, u32 n) {
+    for(u32 i = 0; i < n; i++)
+        ((u8 *) buffer)[i] = backup[backup_bank][(u16) (offset + i)];
+}
+
+void backup_write_byte(u16 offset, u8 byte) {
+    backup[backup_bank][offset] = byte;
+}
+
+void backup_write(u16 offset, const void *buffer, u32 n) {
+    for(u32 i = 0; i < n; i++)
+        backup[backup_bank][(u16) (offset + i)] = ((const u8 *) buffer)[i];
+}
+
+void backup_erase_chip(void) {
+    memset(backup, 0xff, sizeof(backup));
+}
+
+void memory_copy_32(volatile void *dest, const volatile void *src,
+                    u32 n) {
+    memcpy((void *) dest, (const void *) src, n);
+}
+
+void memory_set_32(volatile void *dest, u32 byte, u32 n) {
+    memset((void *) dest, byte, n);
+}
+
+i32 math_sin(u16 angle) {
+    return (i32) (sin(angle * M_PI / 0x8000) * 0x4000);
+}
+
+i32 math_cos(u16 angle) {
+    return (i32) (cos(angle * M_PI / 0x8000) * 0x4000);
+}
+
+// NOTE this is not the generator used by libsimplegba: worlds generated
+// on the host are different from the ones generated on the console.
+static u32 seed;
+
+u16 random(u32 bound) {
+    seed = seed * 1103515245 + 12345;
+    return ((seed >> 16) & RANDOM_MAX) % bound;
+}
+
+u32 random_seed(u32 new_seed) {
+    u32 old_seed = seed;
+    seed = new_seed;
+    return old_seed;
+}
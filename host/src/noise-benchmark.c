@@ -0,0 +1,141 @@
+/* Copyright 2023 Vulcalien
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+// Compares the noise kernel of the generator with the routine it
+// replaced: checks that both produce the same samples and leave the
+// random generator in the same state, then times them.
+//
+// usage: noise-benchmark [repetitions]
+
+#include "../../src/generator.c"
+
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+// the routine that was used before the packed kernel
+static NO_INLINE i8 *reference_noise(i8 *values, u32 feature_size) {
+    for(u32 y = 0; y < LEVEL_H; y += feature_size)
+        for(u32 x = 0; x < LEVEL_W; x += feature_size)
+            set(values, x, y, random(256) - 128);
+
+    for(u32 step_size = feature_size; step_size > 1; step_size /= 2) {
+        u32 half_step = step_size / 2;
+
+        for(u32 y = 0; y < LEVEL_H; y += step_size) {
+            for(u32 x = 0; x < LEVEL_W; x += step_size) {
+                i8 a = get(values, x, y);
+                i8 b = get(values, x + step_size, y);
+                i8 c = get(values, x, y + step_size);
+                i8 d = get(values, x + step_size, y + step_size);
+
+                i8 e = (a + b + c + d) / 4 + variation(step_size);
+
+                i8 f = get(values, x + half_step, y - half_step);
+                i8 g = get(values, x - half_step, y + half_step);
+
+                i8 h = (a + b + e + f) / 4 + variation(step_size) / 2;
+                i8 i = (a + c + e + g) / 4 + variation(step_size) / 2;
+
+                set(values, x + half_step, y + half_step, e);
+                set(values, x + half_step, y, h);
+                set(values, x, y + half_step, i);
+            }
+        }
+    }
+    return values;
+}
+
+typedef i8 *(*NoiseFunction)(i8 *values, u32 feature_size);
+
+// 'noise' writes two samples at a time: the buffers are aligned to 2
+// bytes, but not always to 4 bytes (as in 'levels')
+static u16 buffers[2][LEVEL_W * LEVEL_H / 2 + 1];
+
+static double now(void) {
+    struct timespec t;
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    return t.tv_sec + t.tv_nsec / 1e9;
+}
+
+static bool same_output(u32 seed, u32 feature_size, u32 offset) {
+    i8 *reference = (i8 *) buffers[0] + offset;
+    i8 *packed    = (i8 *) buffers[1] + offset;
+
+    memset(buffers, 0x55, sizeof(buffers));
+
+    random_seed(seed);
+    reference_noise(reference, feature_size);
+    const u32 reference_seed = random_seed(0);
+
+    random_seed(seed);
+    noise(packed, feature_size);
+    const u32 packed_seed = random_seed(0);
+
+    return reference_seed == packed_seed &&
+           memcmp(reference, packed, LEVEL_W * LEVEL_H) == 0;
+}
+
+#define BATCH_CALLS (20)
+
+// returns the microseconds per call, in a batch of BATCH_CALLS calls
+static double run_batch(NoiseFunction function, u32 feature_size) {
+    i8 *values = (i8 *) buffers[0];
+
+    double t0 = now();
+    for(u32 i = 0; i < BATCH_CALLS; i++)
+        function(values, feature_size);
+    return (now() - t0) * 1e6 / BATCH_CALLS;
+}
+
+int main(int argc, char **argv) {
+    u32 repetitions = 2000;
+    if(argc > 1) sscanf(argv[1], "%u", &repetitions);
+
+    static const u32 feature_sizes[] = { 8, 16, 32 };
+
+    printf("feature size  reference    packed\n");
+    for(u32 i = 0; i < sizeof(feature_sizes) / sizeof(feature_sizes[0]); i++) {
+        const u32 feature_size = feature_sizes[i];
+
+        for(u32 seed = 1; seed <= 100; seed++) {
+            if(!same_output(seed, feature_size, 0) ||
+               !same_output(seed, feature_size, 2)) {
+                printf("%12u: the outputs differ (seed %u)\n",
+                       feature_size, seed);
+                return 1;
+            }
+        }
+
+        // The batches of the two routines alternate, and the fastest one
+        // of each is kept: the others are slowed down by the rest of the
+        // system.
+        double reference = 0, packed = 0;
+        random_seed(1);
+        for(u32 r = 0; r < repetitions; r += BATCH_CALLS) {
+            const double reference_time = run_batch(reference_noise, feature_size);
+            const double packed_time    = run_batch(noise, feature_size);
+
+            if(r == 0 || reference_time < reference)
+                reference = reference_time;
+            if(r == 0 || packed_time < packed)
+                packed = packed_time;
+        }
+
+        printf("%12u  %6.1f us  %6.1f us\n", feature_size, reference, packed);
+    }
+    return 0;
+}
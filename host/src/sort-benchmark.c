@@ -0,0 +1,171 @@
+/* Copyright 2023 Vulcalien
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+// Compares 'sort_entities', which only falls back to the counting sort
+// with many entities, with the counting sort alone. The visible entities
+// walk vertically, one pixel per frame, and change direction (or stop)
+// every 64 frames on average. Before timing, it checks that both give the
+// same order, also when entities enter and leave the screen.
+//
+// usage: sort-benchmark [thousands of frames]
+
+#include "minicraft.h"
+
+#include <stdio.h>
+#include <time.h>
+
+#include "level.h"
+
+#include "../../src/draw/sort_entities.c"
+
+static struct Level level;
+
+typedef u8 *(*SortFunction)(struct Level *level, u8 *entities, u32 n);
+
+static u8 entities[128];
+static i8 directions[128];
+
+// the generator of libsimplegba is not used, to keep runs independent
+static u32 seed;
+static inline u32 next_random(void) {
+    seed = seed * 1103515245 + 12345;
+    return seed >> 16;
+}
+
+static void place_entities(u32 n) {
+    seed = 1;
+    for(u32 i = 0; i < n; i++) {
+        entities[i] = i * 2;
+        level.entities[i * 2].y = 16 + next_random() % VALUE_RANGE;
+        directions[i] = next_random() % 3 - 1;
+    }
+}
+
+static inline void move_entities(u32 n) {
+    for(u32 i = 0; i < n; i++) {
+        u16 *y = &level.entities[entities[i]].y;
+
+        if(next_random() % 64 == 0)
+            directions[i] = next_random() % 3 - 1;
+
+        *y += directions[i];
+        if(*y < 16 || *y >= 16 + VALUE_RANGE) {
+            *y -= directions[i];
+            directions[i] = -directions[i];
+        }
+    }
+}
+
+// returns the nanoseconds per frame, or 0 if 'sort' is NULL
+static double run(SortFunction sort, u32 n, u32 frames) {
+    place_entities(n);
+
+    struct timespec t0, t1;
+    clock_gettime(CLOCK_MONOTONIC, &t0);
+
+    volatile u8 sink = 0;
+    for(u32 f = 0; f < frames; f++) {
+        move_entities(n);
+        if(sort)
+            sink += sort(&level, entities, n)[0];
+    }
+
+    clock_gettime(CLOCK_MONOTONIC, &t1);
+    return ((t1.tv_sec - t0.tv_sec) * 1e9 + (t1.tv_nsec - t0.tv_nsec)) /
+           frames;
+}
+
+static bool same_order(u32 n, u32 frames) {
+    place_entities(n);
+
+    for(u32 f = 0; f < frames; f++) {
+        move_entities(n);
+
+        u8 *a = counting_sort(&level, entities, n);
+        u8 *b = sort_entities(&level, entities, n);
+        for(u32 i = 0; i < n; i++)
+            if(a[i] != b[i])
+                return false;
+    }
+    return true;
+}
+
+// Entities enter and leave the visible set: as 'level_find_entities'
+// does, the visible entities are passed in ascending ID order.
+#define CHURN_ENTITIES (120)
+
+static bool same_order_with_churn(u32 frames) {
+    static bool visible[CHURN_ENTITIES];
+
+    seed = 2;
+    for(u32 i = 0; i < CHURN_ENTITIES; i++) {
+        level.entities[i].y = 16 + next_random() % VALUE_RANGE;
+        visible[i] = next_random() % 2;
+    }
+
+    for(u32 f = 0; f < frames; f++) {
+        u32 n = 0;
+        for(u32 i = 0; i < CHURN_ENTITIES; i++) {
+            // sometimes many entities change at once (e.g. a teleport)
+            if(next_random() % (f % 100 == 0 ? 2 : 20) == 0)
+                visible[i] = !visible[i];
+
+            if(visible[i] && n < 128)
+                entities[n++] = i;
+
+            // few distinct values, so that there are many ties
+            if(next_random() % 8 == 0)
+                level.entities[i].y = 16 + next_random() % 24;
+        }
+
+        u8 *a = counting_sort(&level, entities, n);
+        u8 *b = sort_entities(&level, entities, n);
+        for(u32 i = 0; i < n; i++)
+            if(a[i] != b[i])
+                return false;
+    }
+    return true;
+}
+
+int main(int argc, char **argv) {
+    u32 frames = 100;
+    if(argc > 1) sscanf(argv[1], "%u", &frames);
+    frames *= 1000;
+
+    static const u32 sizes[] = { 10, 50, 64, 96, 128 };
+
+    if(!same_order_with_churn(10000)) {
+        printf("the two sorts disagree when entities enter and leave\n");
+        return 1;
+    }
+
+    printf("entities  counting sort  render list\n");
+    for(u32 i = 0; i < sizeof(sizes) / sizeof(sizes[0]); i++) {
+        const u32 n = sizes[i];
+
+        if(!same_order(n, 1000)) {
+            printf("%3u: the two sorts disagree\n", n);
+            return 1;
+        }
+
+        const double base     = run(NULL, n, frames);
+        const double counting = run(counting_sort, n, frames) - base;
+        const double list     = run(sort_entities, n, frames) - base;
+
+        printf("%8u  %10.0f ns  %8.0f ns\n", n, counting, list);
+    }
+    return 0;
+}
@@ -0,0 +1,130 @@
+/* Copyright 2023 Vulcalien
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+// Definitions of the modules that are not part of the simulation core:
+// the main loop, scenes, screen, sounds and performance counters.
+
+#include "minicraft.h"
+
+#include <time.h>
+
+#include "scene.h"
+#include "screen.h"
+#include "sound.h"
+#include "performance.h"
+
+u32 tick_count = 0;
+u32 expected_tickcount = 0;
+
+u32 gametime;
+u32 score;
+
+u8 current_level;
+
+// sound
+u8 _sound_channel;
+
+const u8 sound_start[1804];
+const u8 sound_pickup[512];
+const u8 sound_craft[1764];
+const u8 sound_monster_hurt[876];
+const u8 sound_player_hurt[888];
+const u8 sound_player_death[13608];
+const u8 sound_boss_death[17292];
+
+// scenes
+static void scene_stub(void) {
+}
+
+#define SCENE_STUB(name)\
+    const struct Scene name = { .tick = scene_stub, .draw = scene_stub }
+
+SCENE_STUB(scene_start);
+SCENE_STUB(scene_game);
+SCENE_STUB(scene_transition);
+SCENE_STUB(scene_inventory);
+SCENE_STUB(scene_chest);
+SCENE_STUB(scene_crafting);
+SCENE_STUB(scene_pause);
+SCENE_STUB(scene_death);
+SCENE_STUB(scene_win);
+
+// screen
+void screen_write(const char *text, u8 palette, u32 x, u32 y) {
+}
+
+void screen_draw_frame(const char *title, u32 x, u32 y, u32 w, u32 h) {
+}
+
+void screen_write_time(u32 ticks, u8 palette, u32 x, u32 y) {
+}
+
+void screen_set_bg_palette_color(u8 palette, u8 index, u16 color) {
+}
+
+void screen_load_active_item_palette(u8 palette) {
+}
+
+void screen_update_level_specific(void) {
+}
+
+// there is no VBlank on the host: copy immediately, except to the I/O
+// registers, which do not exist
+void screen_queue_upload(volatile void *dest, const void *src, u32 n) {
+    if((uintptr_t) dest >= 0x04000000 && (uintptr_t) dest < 0x04000400)
+        return;
+    memory_copy_32(dest, src, n);
+}
+
+void screen_sprite_config(u32 id, const struct Sprite *sprite) {
+}
+
+void screen_sprite_hide_range(u32 start, u32 end) {
+}
+
+void screen_commit_sprites(void) {
+}
+
+u32 screen_bg3_shadow[32 * 32 / 2];
+
+void screen_commit_bg3(void) {
+}
+
+void screen_vblank(void) {
+}
+
+// performance: on the host, "cycles" are nanoseconds
+u32 performance_level_tick_cycles;
+
+u32 performance_entity_tick_cycles[ENTITY_TYPES];
+u32 performance_entity_draw_cycles[ENTITY_TYPES];
+
+u32 performance_tick_tiles_cycles;
+u32 performance_draw_tiles_cycles;
+u32 performance_lava_light_cycles;
+u32 performance_sort_cycles;
+
+// the benchmark reports the time of each entity
+bool performance_entity_timing = true;
+
+void performance_init(void) {
+}
+
+u32 performance_cycles(void) {
+    struct timespec t;
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    return t.tv_sec * 1000000000 + t.tv_nsec;
+}
@@ -0,0 +1,290 @@
+/* Copyright 2023 Vulcalien
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+// Generates the worlds of many seeds, using all CPU cores, and writes a
+// CSV line per seed: attempts and time taken by each level, then the
+// number of tiles of each type in each level (including stairs).
+// Percentiles of the generation times are written to stderr.
+//
+// usage: survey [first seed] [number of seeds] [jobs] > survey.csv
+//
+// The generator uses global state ('levels' and the random seed), so the
+// workers are processes. Each worker owns a range of seeds in shared
+// memory: when its range is empty, it steals half of another one.
+
+#include "minicraft.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/wait.h>
+
+#include "level.h"
+#include "tile.h"
+#include "generator.h"
+
+#define MAX_JOBS (256)
+
+static const char * const tile_names[TILE_TYPES] = {
+    "grass", "rock", "liquid", "flower", "tree", "dirt", "sand", "cactus",
+    "hole", "tree_sapling", "cactus_sapling", "farmland", "wheat",
+    "stairs_down", "stairs_up", "infinite_fall", "cloud", "hard_rock",
+    "iron_ore", "gold_ore", "gem_ore", "cloud_cactus"
+};
+
+struct Result {
+    u32 total_us;
+    u32 level_us[5];
+    u16 attempts[5];
+    u16 tiles[5][TILE_TYPES];
+};
+
+struct Range {
+    volatile bool lock;
+    u32 next;
+    u32 end;
+};
+
+static struct Range *ranges;
+static struct Result *results;
+
+static void lock(struct Range *range) {
+    while(__atomic_test_and_set(&range->lock, __ATOMIC_ACQUIRE));
+}
+
+static void unlock(struct Range *range) {
+    __atomic_clear(&range->lock, __ATOMIC_RELEASE);
+}
+
+// Takes the next index of the worker's own range or, if that is empty,
+// steals the upper half of another range. Returns false if no work is
+// left anywhere.
+static bool take_index(u32 worker, u32 jobs, u32 *index) {
+    struct Range *own = &ranges[worker];
+
+    lock(own);
+    bool found = (own->next < own->end);
+    if(found)
+        *index = own->next++;
+    unlock(own);
+
+    for(u32 i = 1; i < jobs && !found; i++) {
+        struct Range *victim = &ranges[(worker + i) % jobs];
+
+        lock(victim);
+        const u32 next = victim->next;
+        const u32 end  = victim->end;
+
+        u32 mid = end;
+        if(next < end) {
+            mid = next + (end - next) / 2;
+            victim->end = mid;
+        }
+        unlock(victim);
+
+        if(mid < end) {
+            // keep the first stolen index, leave the rest to others
+            *index = mid;
+
+            lock(own);
+            own->next = mid + 1;
+            own->end  = end;
+            unlock(own);
+
+            found = true;
+        }
+    }
+    return found;
+}
+
+static double now(void) {
+    struct timespec t;
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    return t.tv_sec + t.tv_nsec / 1e9;
+}
+
+static void survey_seed(u32 seed, struct Result *result) {
+    random_seed(seed);
+
+    double t0 = now();
+    generate_levels();
+    result->total_us = (now() - t0) * 1e6;
+
+    for(u32 l = 0; l < 5; l++) {
+        // on the host, cycles are nanoseconds
+        result->level_us[l] = generator_cycles[l] / 1000;
+        result->attempts[l] = generator_attempts[l];
+
+        for(u32 t = 0; t < TILE_TYPES; t++)
+            result->tiles[l][t] = 0;
+        for(u32 i = 0; i < LEVEL_W * LEVEL_H; i++)
+            result->tiles[l][levels[l].tiles[i]]++;
+    }
+}
+
+static void run_worker(u32 worker, u32 jobs, u32 first_seed) {
+    u32 index;
+    while(take_index(worker, jobs, &index))
+        survey_seed(first_seed + index, &results[index]);
+}
+
+static void write_csv(u32 first_seed, u32 count) {
+    printf("seed,total_us");
+    for(u32 l = 0; l < 5; l++)
+        printf(",l%u_attempts,l%u_us", l, l);
+    for(u32 l = 0; l < 5; l++)
+        for(u32 t = 0; t < TILE_TYPES; t++)
+            printf(",l%u_%s", l, tile_names[t]);
+    printf("\n");
+
+    for(u32 i = 0; i < count; i++) {
+        const struct Result *result = &results[i];
+
+        printf("%u,%u", first_seed + i, result->total_us);
+        for(u32 l = 0; l < 5; l++)
+            printf(",%u,%u", result->attempts[l], result->level_us[l]);
+        for(u32 l = 0; l < 5; l++)
+            for(u32 t = 0; t < TILE_TYPES; t++)
+                printf(",%u", result->tiles[l][t]);
+        printf("\n");
+    }
+}
+
+// shell sort: the standard library conflicts with libsimplegba's 'random'
+static void sort(u32 *values, u32 n) {
+    for(u32 gap = n / 2; gap > 0; gap /= 2) {
+        for(u32 i = gap; i < n; i++) {
+            const u32 val = values[i];
+
+            u32 j = i;
+            for(; j >= gap && values[j - gap] > val; j -= gap)
+                values[j] = values[j - gap];
+            values[j] = val;
+        }
+    }
+}
+
+static void print_percentiles(const char *name, u32 *values, u32 n) {
+    sort(values, n);
+    fprintf(
+        stderr, "%-8s %8u %8u %8u %8u\n", name,
+        values[n * 50 / 100], values[n * 90 / 100],
+        values[n * 99 / 100], values[n - 1]
+    );
+}
+
+static void write_summary(u32 count, double elapsed, u32 jobs) {
+    static u32 values[2][1 << 20];
+    if(count > sizeof(values[0]) / sizeof(values[0][0]))
+        return;
+
+    fprintf(stderr, "%u seeds in %.2f s with %u jobs\n",
+            count, elapsed, jobs);
+    fprintf(stderr, "time (us)     p50      p90      p99      max\n");
+
+    for(u32 i = 0; i < count; i++)
+        values[0][i] = results[i].total_us;
+    print_percentiles("total", values[0], count);
+
+    for(u32 l = 0; l < 5; l++) {
+        char name[16];
+        snprintf(name, sizeof(name), "level %u", l);
+
+        for(u32 i = 0; i < count; i++)
+            values[0][i] = results[i].level_us[l];
+        print_percentiles(name, values[0], count);
+    }
+
+    fprintf(stderr, "attempts      p50      p90      p99      max\n");
+    for(u32 l = 0; l < 5; l++) {
+        char name[16];
+        snprintf(name, sizeof(name), "level %u", l);
+
+        for(u32 i = 0; i < count; i++)
+            values[1][i] = results[i].attempts[l];
+        print_percentiles(name, values[1], count);
+    }
+}
+
+int main(int argc, char **argv) {
+    u32 first_seed = 1;
+    u32 count = 1000;
+    u32 jobs = sysconf(_SC_NPROCESSORS_ONLN);
+
+    if(argc > 1) sscanf(argv[1], "%u", &first_seed);
+    if(argc > 2) sscanf(argv[2], "%u", &count);
+    if(argc > 3) sscanf(argv[3], "%u", &jobs);
+
+    if(jobs < 1)
+        jobs = 1;
+    if(jobs > MAX_JOBS)
+        jobs = MAX_JOBS;
+    if(jobs > count && count > 0)
+        jobs = count;
+
+    // shared with the workers
+    const size_t shared_size = MAX_JOBS * sizeof(struct Range) +
+                               count * sizeof(struct Result);
+    u8 *shared = mmap(
+        NULL, shared_size, PROT_READ | PROT_WRITE,
+        MAP_SHARED | MAP_ANONYMOUS, -1, 0
+    );
+    if(shared == MAP_FAILED) {
+        perror("mmap");
+        return 1;
+    }
+    ranges  = (struct Range *) shared;
+    results = (struct Result *) (shared + MAX_JOBS * sizeof(struct Range));
+
+    // split the seeds evenly, then let the workers balance the load
+    for(u32 w = 0; w < jobs; w++) {
+        ranges[w].lock = false;
+        ranges[w].next = (u64) count * w / jobs;
+        ranges[w].end  = (u64) count * (w + 1) / jobs;
+    }
+
+    double t0 = now();
+    for(u32 w = 0; w < jobs; w++) {
+        pid_t pid = fork();
+        if(pid < 0) {
+            perror("fork");
+            return 1;
+        }
+        if(pid == 0) {
+            run_worker(w, jobs, first_seed);
+            _exit(0);
+        }
+    }
+
+    bool failed = false;
+    for(u32 w = 0; w < jobs; w++) {
+        int status;
+        if(wait(&status) < 0 || !WIFEXITED(status) || WEXITSTATUS(status))
+            failed = true;
+    }
+    if(failed) {
+        fprintf(stderr, "a worker failed\n");
+        return 1;
+    }
+    double elapsed = now() - t0;
+
+    write_csv(first_seed, count);
+    if(count > 0)
+        write_summary(count, elapsed, jobs);
+    return 0;
+}
@@ -94,6 +94,9 @@ extern const struct Entity smash_particle_entity;
 
 extern const struct Entity * const entity_list[ENTITY_TYPES];
 
+// number of ticks that the entity being ticked should simulate
+extern u8 entity_tick_scale;
+
 extern bool entity_move(struct Level *level, struct entity_Data *data,
                         i32 xm, i32 ym);
 
@@ -20,4 +20,18 @@
 
 extern void generate_levels(void);
 
+// 'generate_levels' can also be split over several frames: after calling
+// 'generate_begin', each call of 'generate_step' does one noise pass or
+// one placement phase, until it returns true. The generated world is the
+// same. 'generate_progress' returns the percentage of the phases done: it
+// goes back when an attempt is rejected.
+extern void generate_begin(void);
+extern bool generate_step(void);
+extern u32 generate_progress(void);
+
+// attempts and time (in CPU cycles) spent by the last generation on each
+// level
+extern u16 generator_attempts[5];
+extern u32 generator_cycles[5];
+
 #endif // MINICRAFT_GENERATOR
@@ -23,6 +23,14 @@
 
 #define DESPAWN_DISTANCE ((32 * 16) * (32 * 16))
 
+// Zombies, slimes and items that are far from the player are ticked less
+// often: every 2 ticks beyond the near distance and every 4 ticks beyond
+// the far distance. Beyond the freeze distance they are not ticked at all
+// (and do not despawn): 0 disables freezing.
+#define ENTITY_LOD_NEAR_DISTANCE   (10 * 16)
+#define ENTITY_LOD_FAR_DISTANCE    (20 * 16)
+#define ENTITY_LOD_FREEZE_DISTANCE (0)
+
 #define ENTITY_LIMIT (255)
 
 struct entity_Data {
@@ -48,17 +56,43 @@ struct Level {
 
 extern struct Level levels[5];
 
+// maximum number of solid entities in a tile (must not exceed 127)
 #define SOLID_ENTITIES_IN_TILE (8)
-extern u8 level_solid_entities[LEVEL_W * LEVEL_H][SOLID_ENTITIES_IN_TILE];
+
+// Returns the solid entities of the loaded level that are in the given
+// tile: unused elements are set to -1. The returned pointer is valid
+// until a solid entity is added, removed or moved.
+extern const u8 *level_get_solid_entities(u32 tile);
+
+// IDs of the live entities of the loaded level, sorted in ascending order
+extern u8 level_live_entities[ENTITY_LIMIT];
+extern u32 level_live_entity_count;
+
+// size of the cells used by 'level_find_entities', in tiles
+#define LEVEL_CELL_SIZE (4)
+#define LEVEL_CELLS_W (LEVEL_W / LEVEL_CELL_SIZE)
+#define LEVEL_CELLS_H (LEVEL_H / LEVEL_CELL_SIZE)
 
 extern u32 level_x_offset;
 extern u32 level_y_offset;
 
 extern void level_load(struct Level *level);
 
+// 'level_load' can also be split over several frames: after calling
+// 'level_load_begin', the level can be drawn, but the rest of the work is
+// done by calling 'level_load_step' until it returns true. If needed,
+// 'level_tick' completes the loading.
+extern void level_load_begin(struct Level *level);
+extern bool level_load_step(void);
+
 extern void level_tick(struct Level *level);
 extern void level_draw(struct Level *level);
 
+// Must be called after changing a tile of a level, so that the caches of
+// the loaded level can be updated. LEVEL_SET_TILE and LEVEL_SET_DATA do
+// this automatically.
+extern void level_tile_changed(struct Level *level, u32 xt, u32 yt);
+
 #define LEVEL_GET_TILE(level, xt, yt)\
     (((xt) < 0 || (xt) >= LEVEL_W || (yt) < 0 || (yt) >= LEVEL_H) ?\
         ROCK_TILE : (level)->tiles[(xt) + (yt) * LEVEL_W])
@@ -66,6 +100,7 @@ extern void level_draw(struct Level *level);
     if((xt) >= 0 && (xt) < LEVEL_W && (yt) >= 0 && (yt) < LEVEL_H) {\
         (level)->tiles[(xt) + (yt) * LEVEL_W] = (val);\
         (level)->data[(xt) + (yt) * LEVEL_W]  = (data_val);\
+        level_tile_changed((level), (xt), (yt));\
     }\
 } while(0)
 
@@ -77,8 +112,10 @@ extern void level_draw(struct Level *level);
     (((xt) < 0 || (xt) >= LEVEL_W || (yt) < 0 || (yt) >= LEVEL_H) ?\
         0 : (level)->data[(xt) + (yt) * LEVEL_W])
 #define LEVEL_SET_DATA(level, xt, yt, val) do {\
-    if((xt) >= 0 && (xt) < LEVEL_W && (yt) >= 0 && (yt) < LEVEL_H)\
+    if((xt) >= 0 && (xt) < LEVEL_W && (yt) >= 0 && (yt) < LEVEL_H) {\
         (level)->data[(xt) + (yt) * LEVEL_W] = (val);\
+        level_tile_changed((level), (xt), (yt));\
+    }\
 } while(0)
 
 extern u8 level_new_entity(struct Level *level, u8 type);
@@ -87,4 +124,9 @@ extern void level_add_entity(struct Level *level, u8 entity_id);
 
 extern void level_try_spawn(struct Level *level, u8 level_index);
 
+// Writes to 'result' the IDs, in ascending order, of the entities of the
+// loaded level that may intersect the given rectangle (in pixels), then
+// returns how many there are. 'result' must fit ENTITY_LIMIT IDs.
+extern u32 level_find_entities(i32 x0, i32 y0, i32 x1, i32 y1, u8 *result);
+
 #endif // MINICRAFT_LEVEL
@@ -43,6 +43,11 @@ extern void mob_tick(struct Level *level, struct entity_Data *data);
 extern bool mob_move(struct Level *level, struct entity_Data *data,
                      i32 xm, i32 ym);
 
+// Same as 'mob_move', but moves at most 'steps' pixels instead of one
+// pixel for each tick that the mob simulates.
+extern bool mob_move_steps(struct Level *level, struct entity_Data *data,
+                           i32 xm, i32 ym, u32 steps);
+
 extern void mob_hurt(struct Level *level, struct entity_Data *data,
                      u8 damage, u8 knockback_dir);
 
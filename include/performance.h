@@ -18,6 +18,31 @@
 
 #include "minicraft.h"
 
+#include "entity.h"
+
+// cycles spent in the last call of 'level_tick'
+extern u32 performance_level_tick_cycles;
+
+// Cycles spent in each part of 'level_tick' and 'level_draw', summed
+// until the next update of the performance overlay.
+extern u32 performance_entity_tick_cycles[ENTITY_TYPES];
+extern u32 performance_entity_draw_cycles[ENTITY_TYPES];
+
+extern u32 performance_tick_tiles_cycles;
+extern u32 performance_draw_tiles_cycles;
+extern u32 performance_lava_light_cycles;
+extern u32 performance_sort_cycles;
+
+// Timing each entity costs two reads of the counter per entity: it is only
+// done while the overlay shows the tick or draw page.
+extern bool performance_entity_timing;
+
+extern void performance_init(void);
+
+// Returns the value of a free-running 32-bit counter that is incremented
+// every CPU cycle (16.78 MHz).
+extern u32 performance_cycles(void);
+
 extern void performance_tick(void);
 extern void performance_draw(void);
 extern void performance_vblank(void);
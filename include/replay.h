@@ -0,0 +1,62 @@
+/* Copyright 2023 Vulcalien
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+#ifndef MINICRAFT_REPLAY
+#define MINICRAFT_REPLAY
+
+#include "minicraft.h"
+
+#define REPLAY_OFF       (0)
+#define REPLAY_RECORDING (1)
+#define REPLAY_PLAYING   (2)
+
+// maximum number of entries in the replay stream
+#define REPLAY_STREAM_SIZE (8 * 1024)
+
+// Each entry of the replay stream holds the state of the keys (bits 0-9)
+// and how many consecutive ticks, minus one, it lasted (bits 10-15).
+#define REPLAY_KEYS_MASK (0x03ff)
+#define REPLAY_RUN_SHIFT (10)
+
+extern u8 replay_mode;
+
+// random seed and options the recorded game was started with
+extern u32 replay_seed;
+extern bool replay_keep_inventory;
+
+extern u16 replay_stream[REPLAY_STREAM_SIZE];
+extern u32 replay_length;
+
+// Starts recording a new game: must be called after the random seed is
+// set and before the levels are generated.
+extern void replay_record(void);
+
+// Starts playing the replay stream, restoring the random seed: the
+// levels must then be generated as in a new game. Returns false if there
+// is nothing to play.
+extern bool replay_play(void);
+
+// Must be called once per tick, after 'input_update'. Pressing SELECT
+// while playing gives control back to the player.
+extern void replay_update(void);
+
+// The game reads the keys through these functions: while recording or
+// playing, they return the keys of the replay instead of the real ones.
+extern bool game_input_down(u16 key);
+extern bool game_input_press(u16 key);
+extern bool game_input_release(u16 key);
+extern bool game_input_repeat(u16 key);
+
+#endif // MINICRAFT_REPLAY
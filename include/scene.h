@@ -33,6 +33,8 @@ extern const struct Scene scene_instructions;
 extern const struct Scene scene_about;
 extern const struct Scene scene_options;
 
+extern const struct Scene scene_generating;
+
 extern const struct Scene scene_game;
 extern const struct Scene scene_transition;
 
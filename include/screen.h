@@ -21,7 +21,12 @@
 #define BG0_TILEMAP display_screenblock(16)
 #define BG1_TILEMAP display_screenblock(17)
 #define BG2_TILEMAP display_screenblock(18)
-#define BG3_TILEMAP display_screenblock(19)
+
+// BG3 (text and GUI) is drawn into a RAM copy: 'screen_commit_bg3' finds
+// the changed cells, which are written to VRAM during the next VBlank.
+#define BG3_TILEMAP ((u16 *) screen_bg3_shadow)
+
+extern u32 screen_bg3_shadow[32 * 32 / 2];
 
 extern void screen_init(void);
 
@@ -41,4 +46,33 @@ extern void screen_load_active_item_palette(u8 palette);
 
 extern void screen_update_level_specific(void);
 
+// A cached widget is a part of the screen that is drawn again only when
+// the value it shows (its key) changes. Widgets start invalid.
+struct screen_Widget {
+    u32 key;
+    u32 generation;
+};
+
+// Returns true, and stores 'key', if the widget has to be drawn.
+extern bool screen_widget_changed(struct screen_Widget *widget, u32 key);
+
+// Makes all widgets invalid, e.g. after the screen is cleared.
+extern void screen_invalidate_widgets(void);
+
+// Queues a copy of 'n' bytes (a multiple of 4) from 'src' to 'dest': the
+// copy is done by DMA at the start of the next VBlank, so 'src' must not
+// change until then. If the queue is full, the copy is done immediately.
+extern void screen_queue_upload(volatile void *dest, const void *src, u32 n);
+
+// Sprites are configured in a RAM copy of OAM: the changed entries are
+// uploaded by 'screen_commit_sprites', with 'screen_queue_upload'.
+extern void screen_sprite_config(u32 id, const struct Sprite *sprite);
+extern void screen_sprite_hide_range(u32 start, u32 end);
+extern void screen_commit_sprites(void);
+
+extern void screen_commit_bg3(void);
+
+// Must be called by the VBlank ISR.
+extern void screen_vblank(void);
+
 #endif // MINICRAFT_SCREEN
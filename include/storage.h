@@ -23,6 +23,7 @@ extern bool storage_verify_checksum(void);
 
 extern void storage_srand(void);
 extern void storage_load_options(void);
+extern void storage_load_replay(void);
 
 extern void storage_load(void);
 extern void storage_save(void);
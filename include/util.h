@@ -35,4 +35,14 @@ INLINE void itoa(u32 number, u8 radix, char *array, u8 digits, bool zero_fill) {
     }
 }
 
+// Returns the index of the least significant bit that is set.
+// The ARM7TDMI has no CLZ instruction, so a De Bruijn sequence is used.
+INLINE u32 lowest_set_bit(u32 val) {
+    static const u8 debruijn_table[32] = {
+         0,  1, 28,  2, 29, 14, 24,  3, 30, 22, 20, 15, 25, 17,  4,  8,
+        31, 27, 13, 23, 21, 19, 16,  7, 26, 12, 18,  6, 11,  5, 10,  9
+    };
+    return debruijn_table[((val & -val) * 0x077cb531) >> 27];
+}
+
 #endif // MINICRAFT_UTIL
@@ -0,0 +1,210 @@
+/* Copyright 2023 Vulcalien
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+#include "level.h"
+
+#include "tile.h"
+
+// The lava light of level 0 is computed when the level is loaded and
+// patched when a liquid tile changes. Each 8x8 cell of the level has a
+// light value from 0 to 2, packed in 2 bits.
+#define LIGHT_MAP_W (LEVEL_W * 2)
+#define LIGHT_MAP_H (LEVEL_H * 2)
+
+// radius of the light of a source, in cells
+#define LAVA_LIGHT_RADIUS (5)
+
+SBSS_SECTION
+static u8 lava_light_map[LIGHT_MAP_W * LIGHT_MAP_H / 4];
+
+// liquid tiles that emit light
+SBSS_SECTION
+static u32 lava_light_sources[(LEVEL_W * LEVEL_H + 31) / 32];
+
+// BG2 tilemap entries of two adjacent cells, indexed by their 4 bits
+static const u32 light_pairs[16] = {
+    192 | 192 << 16, 193 | 192 << 16, 194 | 192 << 16, 195 | 192 << 16,
+    192 | 193 << 16, 193 | 193 << 16, 194 | 193 << 16, 195 | 193 << 16,
+    192 | 194 << 16, 193 | 194 << 16, 194 | 194 << 16, 195 | 194 << 16,
+    192 | 195 << 16, 193 | 195 << 16, 194 | 195 << 16, 195 | 195 << 16
+};
+
+// In a line of liquid tiles, only one out of two emits light
+static inline bool is_lava_light_source(struct Level *level, i32 xt, i32 yt) {
+    if(LEVEL_GET_TILE(level, xt, yt) != LIQUID_TILE)
+        return false;
+
+    if(xt & 1 &&
+       LEVEL_GET_TILE(level, xt - 1, yt) == LIQUID_TILE &&
+       LEVEL_GET_TILE(level, xt + 1, yt) == LIQUID_TILE)
+        return false;
+
+    if(yt & 1 &&
+       LEVEL_GET_TILE(level, xt, yt - 1) == LIQUID_TILE &&
+       LEVEL_GET_TILE(level, xt, yt + 1) == LIQUID_TILE)
+        return false;
+
+    return true;
+}
+
+static inline bool get_light_source(u32 tile) {
+    return (lava_light_sources[tile / 32] >> (tile % 32)) & 1;
+}
+
+static inline void set_light_source(u32 tile, bool val) {
+    if(val)
+        lava_light_sources[tile / 32] |= 1u << (tile % 32);
+    else
+        lava_light_sources[tile / 32] &= ~(1u << (tile % 32));
+}
+
+static inline u32 get_light(u32 xl, u32 yl) {
+    const u32 cell = xl + yl * LIGHT_MAP_W;
+    return (lava_light_map[cell / 4] >> (cell % 4 * 2)) & 3;
+}
+
+static inline void set_light(u32 xl, u32 yl, u32 val) {
+    const u32 cell = xl + yl * LIGHT_MAP_W;
+    const u32 shift = cell % 4 * 2;
+
+    lava_light_map[cell / 4] &= ~(3 << shift);
+    lava_light_map[cell / 4] |= val << shift;
+}
+
+// Adds the light of the source in (xt, yt) to the cells of the given
+// area (in cells, upper bounds excluded).
+static inline void add_light_source(i32 xt, i32 yt,
+                                    i32 xa0, i32 ya0, i32 xa1, i32 ya1) {
+    const i32 xr = xt * 2 + 1;
+    const i32 yr = yt * 2 + 1;
+
+    i32 xl0 = xr - LAVA_LIGHT_RADIUS;
+    i32 yl0 = yr - LAVA_LIGHT_RADIUS;
+    i32 xl1 = xr + LAVA_LIGHT_RADIUS;
+    i32 yl1 = yr + LAVA_LIGHT_RADIUS;
+
+    if(xl0 < xa0) xl0 = xa0;
+    if(yl0 < ya0) yl0 = ya0;
+    if(xl1 > xa1) xl1 = xa1;
+    if(yl1 > ya1) yl1 = ya1;
+
+    for(i32 yl = yl0; yl < yl1; yl++) {
+        u32 yd = (yl - yr + (yl >= yr)) * (yl - yr + (yl >= yr));
+
+        for(i32 xl = xl0; xl < xl1; xl++) {
+            u32 xd = (xl - xr + (xl >= xr)) * (xl - xr + (xl >= xr));
+
+            u32 val = (xd + yd <= 34) + (xd + yd <= 24);
+            if(get_light(xl, yl) < val)
+                set_light(xl, yl, val);
+        }
+    }
+}
+
+// Computes the light sources and the lava light of the tile rows from
+// 'y0' to 'y1' (excluded). Rows can be computed in any order: a row only
+// depends on the tiles, not on the light of other rows.
+static inline void load_lava_light(struct Level *level, u32 y0, u32 y1) {
+    for(u32 yt = y0; yt < y1; yt++)
+        for(u32 xt = 0; xt < LEVEL_W; xt++)
+            set_light_source(xt + yt * LEVEL_W,
+                             is_lava_light_source(level, xt, yt));
+
+    // clear the cells of the rows, 4 cells per byte
+    for(u32 i = y0 * 2 * LIGHT_MAP_W / 4; i < y1 * 2 * LIGHT_MAP_W / 4; i++)
+        lava_light_map[i] = 0;
+
+    // add the sources that reach the rows, including those outside of
+    // them (which may not be in the sources bitmap yet)
+    const u32 reach = (LAVA_LIGHT_RADIUS + 1) / 2;
+    const u32 ys0 = (y0 >= reach) ? y0 - reach : 0;
+    const u32 ys1 = (y1 + reach <= LEVEL_H) ? y1 + reach : LEVEL_H;
+
+    for(u32 yt = ys0; yt < ys1; yt++) {
+        for(u32 xt = 0; xt < LEVEL_W; xt++) {
+            if(is_lava_light_source(level, xt, yt)) {
+                add_light_source(
+                    xt, yt, 0, y0 * 2, LIGHT_MAP_W, y1 * 2
+                );
+            }
+        }
+    }
+}
+
+// Must be called when a tile of level 0 changes: a tile can only change
+// whether itself and its 4 neighbors are light sources.
+static inline void update_lava_light(struct Level *level, i32 xt, i32 yt) {
+    bool changed = false;
+    for(i32 y = yt - 1; y <= yt + 1; y++) {
+        for(i32 x = xt - 1; x <= xt + 1; x++) {
+            if(x < 0 || x >= LEVEL_W || y < 0 || y >= LEVEL_H)
+                continue;
+
+            const bool is_source = is_lava_light_source(level, x, y);
+            if(is_source != get_light_source(x + y * LEVEL_W)) {
+                set_light_source(x + y * LEVEL_W, is_source);
+                changed = true;
+            }
+        }
+    }
+    if(!changed)
+        return;
+
+    // clear the cells that those sources could light...
+    i32 xa0 = (xt - 1) * 2 + 1 - LAVA_LIGHT_RADIUS;
+    i32 ya0 = (yt - 1) * 2 + 1 - LAVA_LIGHT_RADIUS;
+    i32 xa1 = (xt + 1) * 2 + 1 + LAVA_LIGHT_RADIUS;
+    i32 ya1 = (yt + 1) * 2 + 1 + LAVA_LIGHT_RADIUS;
+
+    if(xa0 < 0) xa0 = 0;
+    if(ya0 < 0) ya0 = 0;
+    if(xa1 > LIGHT_MAP_W) xa1 = LIGHT_MAP_W;
+    if(ya1 > LIGHT_MAP_H) ya1 = LIGHT_MAP_H;
+
+    for(i32 yl = ya0; yl < ya1; yl++)
+        for(i32 xl = xa0; xl < xa1; xl++)
+            set_light(xl, yl, 0);
+
+    // ...then add again all sources that reach them
+    const i32 range = (LAVA_LIGHT_RADIUS + 1) / 2 + 2;
+    for(i32 y = yt - range; y <= yt + range; y++) {
+        for(i32 x = xt - range; x <= xt + range; x++) {
+            if(x < 0 || x >= LEVEL_W || y < 0 || y >= LEVEL_H)
+                continue;
+
+            if(get_light_source(x + y * LEVEL_W))
+                add_light_source(x, y, xa0, ya0, xa1, ya1);
+        }
+    }
+}
+
+// Copies the visible part of the light map to a 32x20 light layer
+static inline void draw_lava_light(u32 *light) {
+    const u32 x0 = (level_x_offset >> 4) * 2;
+    const u32 y0 = (level_y_offset >> 4) * 2;
+
+    for(u32 yl = 0; yl < 20; yl++) {
+        const u32 first_cell = x0 + (y0 + yl) * LIGHT_MAP_W;
+        u32 *light_row = &light[yl * 16];
+
+        // 'x0' is even: each pair of cells is in the same half byte
+        for(u32 xl = 0; xl < 32; xl += 2) {
+            const u32 cell = first_cell + xl;
+            const u32 bits = (lava_light_map[cell / 4] >> (cell % 4 * 2)) & 0xf;
+
+            light_row[xl / 2] = light_pairs[bits];
+        }
+    }
+}
@@ -15,6 +15,33 @@
  */
 #include "level.h"
 
+// Insertion sort of a persistent render list: the Y order of entities
+// rarely changes between frames, so the list of the previous frame is
+// almost sorted already. Entities are ordered by Y, then by ID.
+//
+// With many entities, or when many of them just became visible, the
+// insertion sort moves more entries than a counting sort costs: then the
+// counting sort is used instead.
+#define COUNTING_SORT_MIN (64)
+
+static u8 render_list[128];
+static u32 render_list_size = 0;
+
+// sort keys of the render list, read once per frame
+static u32 render_keys[128];
+
+static bool in_render_list[ENTITY_LIMIT];
+
+// entities given to the current call have 'visible_stamp' == 'stamp'
+static u8 visible_stamp[ENTITY_LIMIT];
+static u8 stamp = 0;
+
+// entities given to the previous call, in the same order
+static u8 previous_entities[128];
+static u32 previous_count = 0;
+
+#define KEY(id) (level->entities[(id)].y << 8 | (id))
+
 // Counting Sort implementation
 
 #define VALUE_RANGE (DISPLAY_HEIGHT + 16)
@@ -24,8 +51,9 @@ static u8 result_array[128];
 
 #define VAL(id) (level->entities[entities[(id)]].y)
 
+// 'entities' must be in ascending ID order, as ties keep the same order
 IWRAM_SECTION
-static u8 *sort_entities(struct Level *level, u8 *entities, u32 n) {
+static u8 *counting_sort(struct Level *level, u8 *entities, u32 n) {
     if(n <= 1)
         return entities;
 
@@ -57,3 +85,105 @@ static u8 *sort_entities(struct Level *level, u8 *entities, u32 n) {
 
     return result_array;
 }
+
+static inline bool same_entities(u8 *entities, u32 n) {
+    if(n != previous_count)
+        return false;
+
+    for(u32 i = 0; i < n; i++)
+        if(entities[i] != previous_entities[i])
+            return false;
+    return true;
+}
+
+// returns the number of entities that became visible
+static inline u32 update_render_list(u8 *entities, u32 n) {
+    stamp++;
+    if(stamp == 0) {
+        for(u32 i = 0; i < ENTITY_LIMIT; i++)
+            visible_stamp[i] = 0;
+        stamp = 1;
+    }
+
+    for(u32 i = 0; i < n; i++) {
+        visible_stamp[entities[i]] = stamp;
+        previous_entities[i] = entities[i];
+    }
+    previous_count = n;
+
+    // remove the entities that are no longer visible
+    u32 size = 0;
+    for(u32 i = 0; i < render_list_size; i++) {
+        const u8 id = render_list[i];
+
+        if(visible_stamp[id] == stamp)
+            render_list[size++] = id;
+        else
+            in_render_list[id] = false;
+    }
+
+    const u32 kept = size;
+
+    // add the entities that became visible
+    for(u32 i = 0; i < n; i++) {
+        const u8 id = entities[i];
+
+        if(!in_render_list[id]) {
+            in_render_list[id] = true;
+            render_list[size++] = id;
+        }
+    }
+    render_list_size = size;
+
+    return size - kept;
+}
+
+IWRAM_SECTION
+static u8 *sort_entities(struct Level *level, u8 *entities, u32 n) {
+    if(n > COUNTING_SORT_MIN) {
+        // drop the render list: it is rebuilt when there are fewer entities
+        for(u32 i = 0; i < render_list_size; i++)
+            in_render_list[render_list[i]] = false;
+        render_list_size = 0;
+        previous_count = 0;
+
+        return counting_sort(level, entities, n);
+    }
+
+    // usually, the same entities are visible as in the previous frame
+    if(!same_entities(entities, n)) {
+        const u32 added = update_render_list(entities, n);
+
+        if(added > n / 2) {
+            u8 *sorted = counting_sort(level, entities, n);
+
+            // keep the list sorted for the next frames
+            for(u32 i = 0; i < n; i++)
+                render_list[i] = sorted[i];
+            return render_list;
+        }
+    }
+
+    const u32 size = render_list_size;
+    for(u32 i = 0; i < size; i++)
+        render_keys[i] = KEY(render_list[i]);
+
+    for(u32 i = 1; i < size; i++) {
+        const u32 key = render_keys[i];
+        if(render_keys[i - 1] <= key)
+            continue;
+
+        const u8 id = render_list[i];
+
+        u32 j = i;
+        do {
+            render_keys[j] = render_keys[j - 1];
+            render_list[j] = render_list[j - 1];
+            j--;
+        } while(j > 0 && render_keys[j - 1] > key);
+
+        render_keys[j] = key;
+        render_list[j] = id;
+    }
+    return render_list;
+}
@@ -0,0 +1,142 @@
+/* Copyright 2023 Vulcalien
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+#include "level.h"
+
+#include "entity.h"
+
+// When the visible entities may need more sprites than available, the
+// most important ones are kept: entities are ranked by type, then by
+// distance to the player. Sparks and particles that do not fit take
+// turns, so each of them is drawn at least every few frames.
+
+#define SPRITE_CLASS_FLICKER (4)
+
+static const u8 sprite_class[ENTITY_TYPES] = {
+    [PLAYER_ENTITY]     = 0,
+    [AIR_WIZARD_ENTITY] = 1,
+
+    [ZOMBIE_ENTITY]     = 2,
+    [SLIME_ENTITY]      = 2,
+    [WORKBENCH_ENTITY]  = 2,
+    [FURNACE_ENTITY]    = 2,
+    [OVEN_ENTITY]       = 2,
+    [ANVIL_ENTITY]      = 2,
+    [CHEST_ENTITY]      = 2,
+    [LANTERN_ENTITY]    = 2,
+
+    [ITEM_ENTITY]       = 3,
+    [SPARK_ENTITY]      = 4,
+
+    [TEXT_PARTICLE_ENTITY]  = 5,
+    [SMASH_PARTICLE_ENTITY] = 5
+};
+
+// maximum number of sprites drawn by an entity
+static const u8 sprite_cost[ENTITY_TYPES] = {
+    [ZOMBIE_ENTITY ... SMASH_PARTICLE_ENTITY] = 1,
+
+    [PLAYER_ENTITY] = 4,
+    [ITEM_ENTITY]   = 2
+};
+
+static u32 budget_ranks[ENTITY_LIMIT];
+static bool budget_selected[ENTITY_LIMIT];
+
+// where the sparks and particles that take turns start from
+static u32 flicker_offset = 0;
+
+static inline u32 get_rank(struct Level *level, struct entity_Data *data,
+                           u8 id) {
+    struct entity_Data *player = &level->entities[0];
+
+    u32 distance;
+    if(player->type < ENTITY_TYPES) {
+        distance = ((data->x > player->x) ? data->x - player->x
+                                          : player->x - data->x) +
+                   ((data->y > player->y) ? data->y - player->y
+                                          : player->y - data->y);
+        if(distance > 0xffff)
+            distance = 0xffff;
+    } else {
+        distance = 0;
+    }
+    return sprite_class[data->type] << 24 | distance << 8 | id;
+}
+
+// Keeps the entities that fit in 'budget' sprites, without changing their
+// order, and returns how many they are.
+IWRAM_SECTION
+static u32 budget_sprites(struct Level *level, u8 *entities, u32 n,
+                          u32 budget) {
+    u32 total_cost = 0;
+    for(u32 i = 0; i < n; i++)
+        total_cost += sprite_cost[level->entities[entities[i]].type];
+
+    if(total_cost <= budget)
+        return n;
+
+    // sort the ranks in ascending order
+    u32 *ranks = budget_ranks;
+    for(u32 i = 0; i < n; i++) {
+        const u8 id = entities[i];
+        const u32 rank = get_rank(level, &level->entities[id], id);
+
+        u32 j = i;
+        while(j > 0 && ranks[j - 1] > rank) {
+            ranks[j] = ranks[j - 1];
+            j--;
+        }
+        ranks[j] = rank;
+
+        budget_selected[id] = false;
+    }
+
+    // keep the most important entities that fit
+    u32 i = 0;
+    for(; i < n; i++) {
+        if(ranks[i] >> 24 >= SPRITE_CLASS_FLICKER)
+            break;
+
+        const u8 id = ranks[i] & 0xff;
+        const u32 cost = sprite_cost[level->entities[id].type];
+        if(cost <= budget) {
+            budget -= cost;
+            budget_selected[id] = true;
+        }
+    }
+
+    // sparks and particles take turns (they all use one sprite)
+    const u32 remaining = n - i;
+    if(remaining > 0 && budget > 0) {
+        flicker_offset %= remaining;
+
+        u32 selected = 0;
+        for(u32 j = 0; j < remaining && selected < budget; j++) {
+            const u32 r = flicker_offset + j;
+            const u8 id = ranks[i + (r < remaining ? r : r - remaining)];
+
+            budget_selected[id] = true;
+            selected++;
+        }
+        flicker_offset += selected;
+    }
+
+    u32 size = 0;
+    for(u32 j = 0; j < n; j++)
+        if(budget_selected[entities[j]])
+            entities[size++] = entities[j];
+    return size;
+}
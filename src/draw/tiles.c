@@ -19,7 +19,7 @@
 
 #define FDRAW(name)\
     static inline void name(struct Level *level, u32 xt, u32 yt,\
-                            u16 tiles[4])
+                            u32 mask, u16 tiles[4])
 
 #define TILE(id, palette) ((id) | (palette) << 12)
 #define TILE_M(id, flip, palette)\
@@ -33,11 +33,112 @@
 #define CONNECTS_TO_LIQUID(level, xt, yt)\
     (LEVEL_GET_TILE_S((level), (xt), (yt))->connects_to.liquid)
 
+// Neighbor mask bits: which neighbors a tile connects to. Liquid and hole
+// tiles use the upper four bits for the sides that connect to sand.
+#define MASK_U  (1 << 0)
+#define MASK_D  (1 << 1)
+#define MASK_L  (1 << 2)
+#define MASK_R  (1 << 3)
+#define MASK_UL (1 << 4)
+#define MASK_DL (1 << 5)
+#define MASK_UR (1 << 6)
+#define MASK_DR (1 << 7)
+
+#define MASK_SAND_SHIFT (4)
+
+// neighbor masks of the tiles of the loaded level
+SBSS_SECTION
+static u8 tile_masks[LEVEL_W * LEVEL_H];
+
+#define SIDES_MASK(level, xt, yt, connects_to) (\
+    connects_to((level), (xt),     (yt) - 1) << 0 |\
+    connects_to((level), (xt),     (yt) + 1) << 1 |\
+    connects_to((level), (xt) - 1, (yt)    ) << 2 |\
+    connects_to((level), (xt) + 1, (yt)    ) << 3\
+)
+
+#define CORNERS_MASK(level, xt, yt, connects_to) (\
+    connects_to((level), (xt) - 1, (yt) - 1) << 4 |\
+    connects_to((level), (xt) - 1, (yt) + 1) << 5 |\
+    connects_to((level), (xt) + 1, (yt) - 1) << 6 |\
+    connects_to((level), (xt) + 1, (yt) + 1) << 7\
+)
+
+#define IS_ROCK(level, xt, yt)\
+    (LEVEL_GET_TILE((level), (xt), (yt)) == ROCK_TILE)
+#define IS_TREE(level, xt, yt)\
+    (LEVEL_GET_TILE((level), (xt), (yt)) == TREE_TILE)
+#define IS_HARD_ROCK(level, xt, yt)\
+    (LEVEL_GET_TILE((level), (xt), (yt)) == HARD_ROCK_TILE)
+#define IS_NOT_INFINITE_FALL(level, xt, yt)\
+    (LEVEL_GET_TILE((level), (xt), (yt)) != INFINITE_FALL_TILE)
+
+static inline u32 get_tile_mask(struct Level *level, i32 xt, i32 yt) {
+    switch(LEVEL_GET_TILE(level, xt, yt)) {
+        case GRASS_TILE:
+        case FLOWER_TILE:
+        case TREE_SAPLING_TILE:
+            return SIDES_MASK(level, xt, yt, CONNECTS_TO_GRASS);
+
+        case SAND_TILE:
+        case CACTUS_SAPLING_TILE:
+            return SIDES_MASK(level, xt, yt, CONNECTS_TO_SAND);
+
+        case LIQUID_TILE:
+        case HOLE_TILE: {
+            const u32 liquid = SIDES_MASK(level, xt, yt, CONNECTS_TO_LIQUID);
+            const u32 sand   = SIDES_MASK(level, xt, yt, CONNECTS_TO_SAND);
+            return liquid | (sand & ~liquid) << MASK_SAND_SHIFT;
+        }
+
+        case ROCK_TILE:
+            return SIDES_MASK(level, xt, yt, IS_ROCK) |
+                   CORNERS_MASK(level, xt, yt, IS_ROCK);
+
+        case TREE_TILE:
+            return SIDES_MASK(level, xt, yt, IS_TREE) |
+                   CORNERS_MASK(level, xt, yt, IS_TREE);
+
+        case HARD_ROCK_TILE:
+            return SIDES_MASK(level, xt, yt, IS_HARD_ROCK) |
+                   CORNERS_MASK(level, xt, yt, IS_HARD_ROCK);
+
+        case CLOUD_TILE:
+            return SIDES_MASK(level, xt, yt, IS_NOT_INFINITE_FALL) |
+                   CORNERS_MASK(level, xt, yt, IS_NOT_INFINITE_FALL);
+    }
+    return 0;
+}
+
+// Updates the masks of a tile and of its 8 neighbors
+static inline void update_tile_masks(struct Level *level, u32 xt, u32 yt) {
+    for(i32 y = (i32) yt - 1; y <= (i32) yt + 1; y++) {
+        if(y < 0 || y >= LEVEL_H)
+            continue;
+
+        for(i32 x = (i32) xt - 1; x <= (i32) xt + 1; x++) {
+            if(x < 0 || x >= LEVEL_W)
+                continue;
+
+            tile_masks[x + y * LEVEL_W] = get_tile_mask(level, x, y);
+        }
+    }
+}
+
+#define MASK_SIDES\
+    bool u = mask & MASK_U;\
+    bool d = mask & MASK_D;\
+    bool l = mask & MASK_L;\
+    bool r = mask & MASK_R
+
+#define MASK_CORNERS\
+    bool ul = mask & MASK_UL;\
+    bool dl = mask & MASK_DL;\
+    bool ur = mask & MASK_UR;\
+    bool dr = mask & MASK_DR
+
 FDRAW(grass_draw) {
-    bool u = CONNECTS_TO_GRASS(level, xt,     yt - 1);
-    bool d = CONNECTS_TO_GRASS(level, xt,     yt + 1);
-    bool l = CONNECTS_TO_GRASS(level, xt - 1, yt    );
-    bool r = CONNECTS_TO_GRASS(level, xt + 1, yt    );
+    MASK_SIDES;
 
     if(u && l)
         tiles[0] = TILE(0, 0);
@@ -61,15 +162,8 @@ FDRAW(grass_draw) {
 }
 
 FDRAW(rock_draw) {
-    bool u = LEVEL_GET_TILE(level, xt,     yt - 1) == ROCK_TILE;
-    bool d = LEVEL_GET_TILE(level, xt,     yt + 1) == ROCK_TILE;
-    bool l = LEVEL_GET_TILE(level, xt - 1, yt    ) == ROCK_TILE;
-    bool r = LEVEL_GET_TILE(level, xt + 1, yt    ) == ROCK_TILE;
-
-    bool ul = LEVEL_GET_TILE(level, xt - 1, yt - 1) == ROCK_TILE;
-    bool dl = LEVEL_GET_TILE(level, xt - 1, yt + 1) == ROCK_TILE;
-    bool ur = LEVEL_GET_TILE(level, xt + 1, yt - 1) == ROCK_TILE;
-    bool dr = LEVEL_GET_TILE(level, xt + 1, yt + 1) == ROCK_TILE;
+    MASK_SIDES;
+    MASK_CORNERS;
 
     if(u && l)
         tiles[0] = TILE(0 + !ul * 20, 2);
@@ -92,19 +186,20 @@ FDRAW(rock_draw) {
         tiles[3] = TILE(15 + d * 2 + r * 3, 2);
 }
 
+// the animation of a liquid tile changes every 10 ticks
+#define LIQUID_ANIMATION_TIME(xt, yt)\
+    (tick_count + 0x109f77 * (xt) - 0xab24af3 * (yt))
+
 FDRAW(liquid_draw) {
-    u32 liquid_rand = (tick_count + 0x109f77 * xt - 0xab24af3 * yt) / 10;
+    u32 liquid_rand = LIQUID_ANIMATION_TIME(xt, yt) / 10;
     liquid_rand = (liquid_rand * 0x248f7b13 + 0xc21840c5) >> 16;
 
-    bool u = CONNECTS_TO_LIQUID(level, xt,     yt - 1);
-    bool d = CONNECTS_TO_LIQUID(level, xt,     yt + 1);
-    bool l = CONNECTS_TO_LIQUID(level, xt - 1, yt    );
-    bool r = CONNECTS_TO_LIQUID(level, xt + 1, yt    );
+    MASK_SIDES;
 
-    bool su = !u & CONNECTS_TO_SAND(level, xt,     yt - 1);
-    bool sd = !d & CONNECTS_TO_SAND(level, xt,     yt + 1);
-    bool sl = !l & CONNECTS_TO_SAND(level, xt - 1, yt    );
-    bool sr = !r & CONNECTS_TO_SAND(level, xt + 1, yt    );
+    bool su = mask & (MASK_U << MASK_SAND_SHIFT);
+    bool sd = mask & (MASK_D << MASK_SAND_SHIFT);
+    bool sl = mask & (MASK_L << MASK_SAND_SHIFT);
+    bool sr = mask & (MASK_R << MASK_SAND_SHIFT);
 
     if(u && l)
         tiles[0] = TILE_M((liquid_rand >> 0) & 3, (liquid_rand >> 2) & 3, 3);
@@ -128,10 +223,7 @@ FDRAW(liquid_draw) {
 }
 
 FDRAW(flower_draw) {
-    bool u = CONNECTS_TO_GRASS(level, xt,     yt - 1);
-    bool d = CONNECTS_TO_GRASS(level, xt,     yt + 1);
-    bool l = CONNECTS_TO_GRASS(level, xt - 1, yt    );
-    bool r = CONNECTS_TO_GRASS(level, xt + 1, yt    );
+    MASK_SIDES;
 
     bool shape = LEVEL_GET_DATA(level, xt, yt) & 1;
 
@@ -167,15 +259,8 @@ FDRAW(flower_draw) {
 }
 
 FDRAW(tree_draw) {
-    bool u = LEVEL_GET_TILE(level, xt,     yt - 1) == TREE_TILE;
-    bool d = LEVEL_GET_TILE(level, xt,     yt + 1) == TREE_TILE;
-    bool l = LEVEL_GET_TILE(level, xt - 1, yt    ) == TREE_TILE;
-    bool r = LEVEL_GET_TILE(level, xt + 1, yt    ) == TREE_TILE;
-
-    bool ul = LEVEL_GET_TILE(level, xt - 1, yt - 1) == TREE_TILE;
-    bool dl = LEVEL_GET_TILE(level, xt - 1, yt + 1) == TREE_TILE;
-    bool ur = LEVEL_GET_TILE(level, xt + 1, yt - 1) == TREE_TILE;
-    bool dr = LEVEL_GET_TILE(level, xt + 1, yt + 1) == TREE_TILE;
+    MASK_SIDES;
+    MASK_CORNERS;
 
     tiles[0] = TILE(36 - (u && l && ul) * 2, 0);
     tiles[1] = TILE(37 - (u && r && ur) * 2, 0);
@@ -191,10 +276,7 @@ FDRAW(dirt_draw) {
 }
 
 FDRAW(sand_draw) {
-    bool u = CONNECTS_TO_SAND(level, xt,     yt - 1);
-    bool d = CONNECTS_TO_SAND(level, xt,     yt + 1);
-    bool l = CONNECTS_TO_SAND(level, xt - 1, yt    );
-    bool r = CONNECTS_TO_SAND(level, xt + 1, yt    );
+    MASK_SIDES;
 
     bool stepped_on = LEVEL_GET_DATA(level, xt, yt) != 0;
 
@@ -227,15 +309,12 @@ FDRAW(cactus_draw) {
 }
 
 FDRAW(hole_draw) {
-    bool u = CONNECTS_TO_LIQUID(level, xt,     yt - 1);
-    bool d = CONNECTS_TO_LIQUID(level, xt,     yt + 1);
-    bool l = CONNECTS_TO_LIQUID(level, xt - 1, yt    );
-    bool r = CONNECTS_TO_LIQUID(level, xt + 1, yt    );
+    MASK_SIDES;
 
-    bool su = !u & CONNECTS_TO_SAND(level, xt,     yt - 1);
-    bool sd = !d & CONNECTS_TO_SAND(level, xt,     yt + 1);
-    bool sl = !l & CONNECTS_TO_SAND(level, xt - 1, yt    );
-    bool sr = !r & CONNECTS_TO_SAND(level, xt + 1, yt    );
+    bool su = mask & (MASK_U << MASK_SAND_SHIFT);
+    bool sd = mask & (MASK_D << MASK_SAND_SHIFT);
+    bool sl = mask & (MASK_L << MASK_SAND_SHIFT);
+    bool sr = mask & (MASK_R << MASK_SAND_SHIFT);
 
     if(u && l)
         tiles[0] = TILE(0, 5);
@@ -259,10 +338,7 @@ FDRAW(hole_draw) {
 }
 
 FDRAW(tree_sapling_draw) {
-    bool u = CONNECTS_TO_GRASS(level, xt,     yt - 1);
-    bool d = CONNECTS_TO_GRASS(level, xt,     yt + 1);
-    bool l = CONNECTS_TO_GRASS(level, xt - 1, yt    );
-    bool r = CONNECTS_TO_GRASS(level, xt + 1, yt    );
+    MASK_SIDES;
 
     tiles[0] = TILE(56 + !u * 4 + !l * 8, 0);
     tiles[1] = TILE(57 + !u * 4 + !r * 8, 0);
@@ -271,10 +347,7 @@ FDRAW(tree_sapling_draw) {
 }
 
 FDRAW(cactus_sapling_draw) {
-    bool u = CONNECTS_TO_SAND(level, xt,     yt - 1);
-    bool d = CONNECTS_TO_SAND(level, xt,     yt + 1);
-    bool l = CONNECTS_TO_SAND(level, xt - 1, yt    );
-    bool r = CONNECTS_TO_SAND(level, xt + 1, yt    );
+    MASK_SIDES;
 
     bool stepped_on = LEVEL_GET_DATA(level, xt, yt) != 0;
 
@@ -322,15 +395,8 @@ FDRAW(infinite_fall_draw) {
 }
 
 FDRAW(cloud_draw) {
-    bool u = LEVEL_GET_TILE(level, xt,     yt - 1) != INFINITE_FALL_TILE;
-    bool d = LEVEL_GET_TILE(level, xt,     yt + 1) != INFINITE_FALL_TILE;
-    bool l = LEVEL_GET_TILE(level, xt - 1, yt    ) != INFINITE_FALL_TILE;
-    bool r = LEVEL_GET_TILE(level, xt + 1, yt    ) != INFINITE_FALL_TILE;
-
-    bool ul = LEVEL_GET_TILE(level, xt - 1, yt - 1) != INFINITE_FALL_TILE;
-    bool dl = LEVEL_GET_TILE(level, xt - 1, yt + 1) != INFINITE_FALL_TILE;
-    bool ur = LEVEL_GET_TILE(level, xt + 1, yt - 1) != INFINITE_FALL_TILE;
-    bool dr = LEVEL_GET_TILE(level, xt + 1, yt + 1) != INFINITE_FALL_TILE;
+    MASK_SIDES;
+    MASK_CORNERS;
 
     if(u && l)
         tiles[0] = TILE(81 - !ul * 61, 7);
@@ -354,15 +420,8 @@ FDRAW(cloud_draw) {
 }
 
 FDRAW(hard_rock_draw) {
-    bool u = LEVEL_GET_TILE(level, xt,     yt - 1) == HARD_ROCK_TILE;
-    bool d = LEVEL_GET_TILE(level, xt,     yt + 1) == HARD_ROCK_TILE;
-    bool l = LEVEL_GET_TILE(level, xt - 1, yt    ) == HARD_ROCK_TILE;
-    bool r = LEVEL_GET_TILE(level, xt + 1, yt    ) == HARD_ROCK_TILE;
-
-    bool ul = LEVEL_GET_TILE(level, xt - 1, yt - 1) == HARD_ROCK_TILE;
-    bool dl = LEVEL_GET_TILE(level, xt - 1, yt + 1) == HARD_ROCK_TILE;
-    bool ur = LEVEL_GET_TILE(level, xt + 1, yt - 1) == HARD_ROCK_TILE;
-    bool dr = LEVEL_GET_TILE(level, xt + 1, yt + 1) == HARD_ROCK_TILE;
+    MASK_SIDES;
+    MASK_CORNERS;
 
     if(u && l)
         tiles[0] = TILE(0 + !ul * 20, 6);
@@ -392,18 +451,75 @@ FDRAW(ore_draw) {
     tiles[3] = TILE(55, 3);
 }
 
-#define CALL(function)\
-    function(level, xt, yt, tiles)
+// Tiles that only depend on their neighbor mask are looked up in a
+// table, which is filled by calling their draw functions once per mask.
+#define GRASS_TABLE        (0)
+#define TREE_SAPLING_TABLE (GRASS_TABLE + 16)
+#define ROCK_TABLE         (TREE_SAPLING_TABLE + 16)
+#define TREE_TABLE         (ROCK_TABLE + 256)
+#define HOLE_TABLE         (TREE_TABLE + 256)
+#define CLOUD_TABLE        (HOLE_TABLE + 256)
+#define HARD_ROCK_TABLE    (CLOUD_TABLE + 256)
+#define MASK_TABLE_SIZE    (HARD_ROCK_TABLE + 256)
+
+SBSS_SECTION
+static u16 mask_table[MASK_TABLE_SIZE][4];
+
+static bool mask_table_filled = false;
+
+#define FILL(table, function, masks)\
+    for(u32 mask = 0; mask < (masks); mask++)\
+        function(NULL, 0, 0, mask, mask_table[(table) + mask])
+
+static inline void fill_mask_table(void) {
+    FILL(GRASS_TABLE,        grass_draw,        16);
+    FILL(TREE_SAPLING_TABLE, tree_sapling_draw, 16);
+    FILL(ROCK_TABLE,         rock_draw,         256);
+    FILL(TREE_TABLE,         tree_draw,         256);
+    FILL(HOLE_TABLE,         hole_draw,         256);
+    FILL(CLOUD_TABLE,        cloud_draw,        256);
+    FILL(HARD_ROCK_TABLE,    hard_rock_draw,    256);
+
+    mask_table_filled = true;
+}
+
+#undef FILL
+
+// computes the masks of the rows from 'y0' to 'y1' (excluded)
+static inline void load_tile_masks(struct Level *level, u32 y0, u32 y1) {
+    if(!mask_table_filled)
+        fill_mask_table();
 
+    for(u32 yt = y0; yt < y1; yt++)
+        for(u32 xt = 0; xt < LEVEL_W; xt++)
+            tile_masks[xt + yt * LEVEL_W] = get_tile_mask(level, xt, yt);
+}
+
+#define CALL(function)\
+    function(level, xt, yt, mask, tiles)
+
+#define LOOKUP(table) do {\
+    const u16 *entry = mask_table[(table) + mask];\
+    tiles[0] = entry[0];\
+    tiles[1] = entry[1];\
+    tiles[2] = entry[2];\
+    tiles[3] = entry[3];\
+} while(0)
+
+// The tile must be inside the level: 'update_offset' keeps the visible
+// tiles away from the borders.
 static inline void draw_tile(struct Level *level, u32 xt, u32 yt,
                              u16 tiles[4]) {
-    switch(LEVEL_GET_TILE(level, xt, yt)) {
+    const u32 tile = xt + yt * LEVEL_W;
+    const u32 mask = tile_masks[tile];
+
+    switch(level->tiles[tile]) {
         case GRASS_TILE:
-            CALL(grass_draw);
+            LOOKUP(GRASS_TABLE);
             break;
 
         case ROCK_TILE:
-            CALL(rock_draw);
+            LOOKUP(ROCK_TABLE);
             break;
 
         case LIQUID_TILE:
@@ -415,7 +531,7 @@ static inline void draw_tile(struct Level *level, u32 xt, u32 yt,
             break;
 
         case TREE_TILE:
-            CALL(tree_draw);
+            LOOKUP(TREE_TABLE);
             break;
 
         case DIRT_TILE:
@@ -431,11 +547,11 @@ static inline void draw_tile(struct Level *level, u32 xt, u32 yt,
             break;
 
         case HOLE_TILE:
-            CALL(hole_draw);
+            LOOKUP(HOLE_TABLE);
             break;
 
         case TREE_SAPLING_TILE:
-            CALL(tree_sapling_draw);
+            LOOKUP(TREE_SAPLING_TABLE);
             break;
 
         case CACTUS_SAPLING_TILE:
@@ -463,11 +579,11 @@ static inline void draw_tile(struct Level *level, u32 xt, u32 yt,
             break;
 
         case CLOUD_TILE:
-            CALL(cloud_draw);
+            LOOKUP(CLOUD_TABLE);
             break;
 
         case HARD_ROCK_TILE:
-            CALL(hard_rock_draw);
+            LOOKUP(HARD_ROCK_TABLE);
             break;
 
         // single cases are slightly faster
@@ -487,3 +603,4 @@ static inline void draw_tile(struct Level *level, u32 xt, u32 yt,
 }
 
 #undef CALL
+#undef LOOKUP
@@ -19,6 +19,8 @@
 #include "tile.h"
 #include "mob.h"
 
+u8 entity_tick_scale = 1;
+
 IWRAM_RODATA_SECTION
 const struct Entity * const entity_list[ENTITY_TYPES] = {
     &zombie_entity,
@@ -144,10 +146,12 @@ bool entity_move2(struct Level *level, struct entity_Data *data,
     bool blocked_by_entity = false;
     for(u32 yt = yt0; yt <= yt1; yt++) {
         for(u32 xt = xt0; xt <= xt1; xt++) {
-            const u32 tile = xt + yt * LEVEL_W;
+            const u8 *solid_entities = level_get_solid_entities(
+                xt + yt * LEVEL_W
+            );
 
             for(u32 i = 0; i < SOLID_ENTITIES_IN_TILE; i++) {
-                const u8 entity_id = level_solid_entities[tile][i];
+                const u8 entity_id = solid_entities[i];
                 if(entity_id >= ENTITY_LIMIT)
                     continue;
 
@@ -20,6 +20,7 @@
 #include "player.h"
 #include "scene.h"
 #include "sound.h"
+#include "screen.h"
 
 struct wizard_Data {
     i8 xm : 2;
@@ -175,7 +176,7 @@ EDRAW(air_wizard_draw) {
             palette = 1;
     }
 
-    sprite_config(used_sprites, &(struct Sprite) {
+    screen_sprite_config(used_sprites, &(struct Sprite) {
         .x = data->x - 8 - level_x_offset,
         .y = data->y - 11 - level_y_offset,
 
@@ -20,6 +20,7 @@
 #include "item.h"
 #include "mob.h"
 #include "player.h"
+#include "screen.h"
 
 SBSS_SECTION
 struct Inventory chest_inventories[CHEST_LIMIT];
@@ -76,7 +77,7 @@ ETICK(furniture_tick) {
 }
 
 EDRAW(furniture_draw) {
-    sprite_config(used_sprites, &(struct Sprite) {
+    screen_sprite_config(used_sprites, &(struct Sprite) {
         .x = data->x - 8 - level_x_offset,
         .y = data->y - 12 - level_y_offset,
 
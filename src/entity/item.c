@@ -19,6 +19,7 @@
 #include "player.h"
 #include "inventory.h"
 #include "sound.h"
+#include "screen.h"
 
 struct item_entity_Data {
     u16 item_type : 6;
@@ -79,15 +80,17 @@ ETICK(item_tick) {
     struct item_entity_Data *item_entity_data =
         (struct item_entity_Data *) &data->data;
 
-    item_entity_data->time--;
-    if(item_entity_data->time == 0) {
+    if(item_entity_data->time <= entity_tick_scale) {
         data->should_remove = true;
         return;
     }
+    item_entity_data->time -= entity_tick_scale;
 
     // use solid_id to store the take delay
-    if(data->solid_id > 0)
-        data->solid_id--;
+    if(data->solid_id > entity_tick_scale)
+        data->solid_id -= entity_tick_scale;
+    else
+        data->solid_id = 0;
 
     // check if player can take
     struct entity_Data *player = &level->entities[0];
@@ -117,28 +120,31 @@ ETICK(item_tick) {
     }
 
     // movement
-    item_entity_data->xx += item_entity_data->xv;
-    item_entity_data->yy += item_entity_data->yv;
+    i32 xm = 0;
+    i32 ym = 0;
+    for(u32 i = 0; i < entity_tick_scale; i++) {
+        item_entity_data->xx += item_entity_data->xv;
+        item_entity_data->yy += item_entity_data->yv;
 
-    item_entity_data->zz += item_entity_data->zv;
-    if(item_entity_data->zz < 0) {
-        item_entity_data->zz = 0;
+        item_entity_data->zz += item_entity_data->zv;
+        if(item_entity_data->zz < 0) {
+            item_entity_data->zz = 0;
 
-        item_entity_data->zv /= -2;
+            item_entity_data->zv /= -2;
 
-        item_entity_data->xv = item_entity_data->xv * 3 / 5;
-        item_entity_data->yv = item_entity_data->yv * 3 / 5;
-    }
-    item_entity_data->zv--;
+            item_entity_data->xv = item_entity_data->xv * 3 / 5;
+            item_entity_data->yv = item_entity_data->yv * 3 / 5;
+        }
+        item_entity_data->zv--;
 
-    entity_move(
-        level, data,
-        item_entity_data->xx / 64,
-        item_entity_data->yy / 64
-    );
+        xm += item_entity_data->xx / 64;
+        ym += item_entity_data->yy / 64;
+
+        item_entity_data->xx %= 64;
+        item_entity_data->yy %= 64;
+    }
 
-    item_entity_data->xx %= 64;
-    item_entity_data->yy %= 64;
+    entity_move(level, data, xm, ym);
 }
 
 EDRAW(item_draw) {
@@ -153,7 +159,7 @@ EDRAW(item_draw) {
     const u16 sprite = 256 + item_entity_data->item_type;
 
     // draw item sprite
-    sprite_config(used_sprites, &(struct Sprite) {
+    screen_sprite_config(used_sprites, &(struct Sprite) {
         .x = data->x - 4 - level_x_offset,
         .y = data->y - 4 - (item_entity_data->zz / 6) - level_y_offset,
 
@@ -171,7 +177,7 @@ EDRAW(item_draw) {
         used_sprites++;
 
         // draw shadow sprite
-        sprite_config(used_sprites, &(struct Sprite) {
+        screen_sprite_config(used_sprites, &(struct Sprite) {
             .x = data->x - 4 - level_x_offset,
             .y = data->y - 4 - level_y_offset,
 
@@ -24,6 +24,8 @@
 #include "scene.h"
 #include "crafting.h"
 #include "sound.h"
+#include "screen.h"
+#include "replay.h"
 
 #define MAX_HP      (10)
 #define MAX_STAMINA (10)
@@ -125,10 +127,15 @@ static inline void player_hurt_entities(struct Level *level, struct entity_Data
 
     for(u32 yt = yt0; yt <= yt1; yt++) {
         for(u32 xt = xt0; xt <= xt1; xt++) {
-            const u32 tile = xt + yt * LEVEL_W;
+            const u8 *solid_entities = level_get_solid_entities(
+                xt + yt * LEVEL_W
+            );
 
             for(u32 i = 0; i < SOLID_ENTITIES_IN_TILE; i++) {
-                const u8 entity_id = level_solid_entities[tile][i];
+                const u8 entity_id = solid_entities[i];
+                if(entity_id >= ENTITY_LIMIT)
+                    continue;
+
                 struct entity_Data *e_data = &level->entities[entity_id];
 
                 switch(e_data->type) {
@@ -189,8 +196,13 @@ static inline void player_take_furniture(struct Level *level, struct entity_Data
     i32 x1 = data->x     + ((dir & 1) == 0) * 8 + (dir == 3) * range - (dir == 1) * 4;
     i32 y1 = data->y - 2 + ((dir & 1) == 1) * 8 + (dir == 2) * range - (dir == 0) * 4;
 
-    for(u32 i = 0; i < ENTITY_LIMIT; i++) {
-        struct entity_Data *e_data = &level->entities[i];
+    u8 nearby_entities[ENTITY_LIMIT];
+    const u32 nearby_count = level_find_entities(
+        x0, y0, x1, y1, nearby_entities
+    );
+
+    for(u32 i = 0; i < nearby_count; i++) {
+        struct entity_Data *e_data = &level->entities[nearby_entities[i]];
 
         switch(e_data->type) {
             case WORKBENCH_ENTITY:
@@ -346,8 +358,13 @@ static inline bool player_use(struct Level *level, struct entity_Data *data) {
     i32 x1 = data->x     + ((dir & 1) == 0) * 8 + (dir == 3) * range - (dir == 1) * 4;
     i32 y1 = data->y - 2 + ((dir & 1) == 1) * 8 + (dir == 2) * range - (dir == 0) * 4;
 
-    for(u32 i = 0; i < ENTITY_LIMIT; i++) {
-        struct entity_Data *e_data = &level->entities[i];
+    u8 nearby_entities[ENTITY_LIMIT];
+    const u32 nearby_count = level_find_entities(
+        x0, y0, x1, y1, nearby_entities
+    );
+
+    for(u32 i = 0; i < nearby_count; i++) {
+        struct entity_Data *e_data = &level->entities[nearby_entities[i]];
 
         if(entity_intersects(e_data, x0, y0, x1, y1)) {
             bool found = true;
@@ -449,8 +466,8 @@ ETICK(player_tick) {
     }
 
     // movement
-    i32 xm = (input_down(KEY_RIGHT) != 0) - (input_down(KEY_LEFT) != 0);
-    i32 ym = (input_down(KEY_DOWN)  != 0) - (input_down(KEY_UP)   != 0);
+    i32 xm = (game_input_down(KEY_RIGHT) != 0) - (game_input_down(KEY_LEFT) != 0);
+    i32 ym = (game_input_down(KEY_DOWN)  != 0) - (game_input_down(KEY_UP)   != 0);
 
     if((player_stamina_recharge_delay & 1) == 0) {
         static u8 swim_move_flag = 0;
@@ -461,24 +478,24 @@ ETICK(player_tick) {
             mob_move(level, data, xm, ym);
     }
 
-    if(player_stamina > 0 && input_repeat(KEY_A)) {
+    if(player_stamina > 0 && game_input_repeat(KEY_A)) {
         player_stamina--;
         stamina_recharge = 0;
 
         player_attack(level, data);
     }
 
-    if(input_repeat(KEY_B)) {
+    if(game_input_repeat(KEY_B)) {
         if(!player_use(level, data))
             set_scene(&scene_inventory, 1);
     }
 
-    if(input_press(KEY_START))
+    if(game_input_press(KEY_START))
         set_scene(&scene_pause, 1);
 }
 
 static inline void draw_furniture(u16 x, u16 y, u32 used_sprites) {
-    sprite_config(used_sprites, &(struct Sprite) {
+    screen_sprite_config(used_sprites, &(struct Sprite) {
         .x = x - 8  - level_x_offset,
         .y = y - 20 - level_y_offset,
 
@@ -499,7 +516,7 @@ static inline void draw_attack(u16 x, u16 y, struct player_Data *player_data,
     x += -4 + ((dir == 3) - (dir == 1)) * 8 - ((dir & 1) == 0) * 4;
     y += -4 + ((dir == 2) - (dir == 0)) * 8 - ((dir & 1) == 1) * 4;
 
-    sprite_config(used_sprites, &(struct Sprite) {
+    screen_sprite_config(used_sprites, &(struct Sprite) {
         .x = x - level_x_offset,
         .y = y - level_y_offset,
 
@@ -527,7 +544,7 @@ static inline void draw_item(u16 x, u16 y, struct player_Data *player_data,
     const u16 tile = 256 + item_type +
         (item->class == ITEMCLASS_TOOL) * (2 + item_tool_level * 5);
 
-    sprite_config(used_sprites, &(struct Sprite) {
+    screen_sprite_config(used_sprites, &(struct Sprite) {
         .x = x - level_x_offset,
         .y = y - level_y_offset,
 
@@ -585,7 +602,7 @@ EDRAW(player_draw) {
         draw_attack(x, y, player_data, used_sprites++);
 
     // draw player sprite
-    sprite_config(used_sprites, &(struct Sprite) {
+    screen_sprite_config(used_sprites, &(struct Sprite) {
         .x = x - 8 - level_x_offset,
         .y = y - 8 - level_y_offset,
 
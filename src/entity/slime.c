@@ -16,6 +16,7 @@
 #include "entity.h"
 
 #include "mob.h"
+#include "screen.h"
 
 struct slime_Data {
     i8 xm : 2;
@@ -54,13 +55,21 @@ ETICK(slime_tick) {
 
     mob_tick(level, data);
 
-    bool move_result = mob_move(
+    // far slimes tick less often: move for all the skipped ticks, but not
+    // further than the rest of the jump
+    u32 steps = entity_tick_scale;
+    if(slime_data->jump_time > 0 && steps > slime_data->jump_time)
+        steps = slime_data->jump_time;
+
+    bool move_result = mob_move_steps(
         level, data,
         slime_data->xm,
-        slime_data->ym
+        slime_data->ym,
+        steps
     );
 
-    if(slime_data->jump_time == -10 && (!move_result || random(40) == 0)) {
+    if(slime_data->jump_time == -10 &&
+       (!move_result || random(40 / entity_tick_scale) == 0)) {
         slime_data->xm = random(3) - 1;
         slime_data->ym = random(3) - 1;
 
@@ -83,14 +92,17 @@ ETICK(slime_tick) {
             }
         }
 
+        // the jump starts in the last of the simulated ticks
         if(slime_data->xm != 0 || slime_data->ym != 0)
-            slime_data->jump_time = 10;
+            slime_data->jump_time = 10 + entity_tick_scale - 1;
     }
 
-    if(slime_data->jump_time > -10)
-        slime_data->jump_time--;
+    if(slime_data->jump_time > -10 + entity_tick_scale)
+        slime_data->jump_time -= entity_tick_scale;
+    else
+        slime_data->jump_time = -10;
 
-    if(slime_data->jump_time == 0)
+    if(slime_data->jump_time <= 0)
         slime_data->xm = slime_data->ym = 0;
 }
 
@@ -102,7 +114,7 @@ EDRAW(slime_draw) {
     u8 palette = (hurt_time > 0)  * 5 +
                  (hurt_time == 0) * slime_data->level;
 
-    sprite_config(used_sprites, &(struct Sprite) {
+    screen_sprite_config(used_sprites, &(struct Sprite) {
         .x = data->x - 8  - level_x_offset,
         .y = data->y - 11 - level_y_offset,
 
@@ -16,6 +16,7 @@
 #include "entity.h"
 
 #include "sound.h"
+#include "screen.h"
 
 struct smash_Data {
     u8 time;
@@ -50,7 +51,7 @@ ETICK(smash_particle_tick) {
 }
 
 EDRAW(smash_particle_draw) {
-    sprite_config(used_sprites, &(struct Sprite) {
+    screen_sprite_config(used_sprites, &(struct Sprite) {
         .x = data->x - 8 - level_x_offset,
         .y = data->y - 8 - level_y_offset,
 
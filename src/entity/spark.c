@@ -16,6 +16,7 @@
 #include "entity.h"
 
 #include "mob.h"
+#include "screen.h"
 
 struct spark_Data {
     u16 time;
@@ -93,10 +94,16 @@ ETICK(spark_tick) {
     u16 yt = (y >> 4);
 
     if(xt < LEVEL_W && yt < LEVEL_H) {
-        u8 *solid_entities = level_solid_entities[xt + yt * LEVEL_W];
+        const u8 *solid_entities = level_get_solid_entities(
+            xt + yt * LEVEL_W
+        );
 
         for(u32 i = 0; i < SOLID_ENTITIES_IN_TILE; i++) {
-            struct entity_Data *e_data = &level->entities[solid_entities[i]];
+            const u8 entity_id = solid_entities[i];
+            if(entity_id >= ENTITY_LIMIT)
+                continue;
+
+            struct entity_Data *e_data = &level->entities[entity_id];
             struct mob_Data *mob_data = (struct mob_Data *) &e_data->data;
 
             switch(e_data->type) {
@@ -115,6 +122,10 @@ ETICK(spark_tick) {
     }
 }
 
+// drawing must not use the game's random generator, or replays would
+// depend on how many frames are skipped
+static u32 draw_seed = 0;
+
 EDRAW(spark_draw) {
     struct spark_Data *spark_data = (struct spark_Data *) &data->data;
 
@@ -122,7 +133,9 @@ EDRAW(spark_draw) {
         if(((spark_data->time / 6) & 1) == 0)
             return 0;
 
-    sprite_config(used_sprites, &(struct Sprite) {
+    draw_seed = draw_seed * 1103515245 + 12345;
+
+    screen_sprite_config(used_sprites, &(struct Sprite) {
         .x = data->x - 4 - level_x_offset,
         .y = data->y - 8 - level_y_offset,
 
@@ -131,7 +144,7 @@ EDRAW(spark_draw) {
         .size = SPRITE_SIZE_8x16,
         .flip = 0,
 
-        .tile = 192 + random(16) * 2,
+        .tile = 192 + (draw_seed >> 16) % 16 * 2,
         .palette = 5
     });
 
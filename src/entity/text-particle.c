@@ -14,6 +14,7 @@
  * along with this program.  If not, see <https://www.gnu.org/licenses/>.
  */
 #include "entity.h"
+#include "screen.h"
 
 struct text_Data {
     u8 time : 6;
@@ -98,7 +99,7 @@ EDRAW(text_particle_draw) {
 
     const u8 length = 1 + (text_data->number >= 10);
 
-    sprite_config(used_sprites, &(struct Sprite) {
+    screen_sprite_config(used_sprites, &(struct Sprite) {
         .x = data->x - length * 4 - level_x_offset,
         .y = data->y - (text_data->zz / 6) - level_y_offset,
 
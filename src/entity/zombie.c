@@ -16,6 +16,7 @@
 #include "entity.h"
 
 #include "mob.h"
+#include "screen.h"
 
 struct zombie_Data {
     i8 xm : 2;
@@ -82,14 +83,16 @@ ETICK(zombie_tick) {
         zombie_data->ym * zombie_data->move_flag
     );
 
-    if(!move_result || random(200) == 0) {
+    if(!move_result || random(200 / entity_tick_scale) == 0) {
         zombie_data->random_walk_time = 60;
         zombie_data->xm = random(2) * (random(3) - 1);
         zombie_data->ym = random(2) * (random(3) - 1);
     }
 
-    if(zombie_data->random_walk_time > 0)
-        zombie_data->random_walk_time--;
+    if(zombie_data->random_walk_time > entity_tick_scale)
+        zombie_data->random_walk_time -= entity_tick_scale;
+    else
+        zombie_data->random_walk_time = 0;
 }
 
 EDRAW(zombie_draw) {
@@ -108,7 +111,7 @@ EDRAW(zombie_draw) {
     u8 palette = (hurt_time > 0)  * 5 +
                  (hurt_time == 0) * zombie_data->level;
 
-    sprite_config(used_sprites, &(struct Sprite) {
+    screen_sprite_config(used_sprites, &(struct Sprite) {
         .x = data->x - 8 - level_x_offset,
         .y = data->y - 11 - level_y_offset,
 
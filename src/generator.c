@@ -18,6 +18,10 @@
 #include "level.h"
 #include "tile.h"
 #include "entity.h"
+#include "performance.h"
+
+u16 generator_attempts[5];
+u32 generator_cycles[5];
 
 static inline i8 get(i8 *values, u32 x, u32 y) {
     if(x >= LEVEL_W || y >= LEVEL_H)
@@ -34,6 +38,106 @@ static inline i32 variation(u32 step_size) {
     return (random(step_size * 4) - step_size * 2);
 }
 
+// The cell at (x, y), of size 'step_size', sets the samples e, h and i:
+//     |     |
+//        f
+//     |     |
+// - - a -h- b
+//     |     |
+//  g  i  e  |
+//     |     |
+// - - c --- d
+// 'var' contains the three variations of the cell, in the order e, h, i.
+
+// edge cells: samples outside of the level are read as 0 and not written
+static inline void noise_edge_cell(i8 *values, u32 x, u32 y, u32 step_size,
+                                   const i32 *var) {
+    u32 half_step = step_size / 2;
+
+    i8 a = get(values, x, y);
+    i8 b = get(values, x + step_size, y);
+    i8 c = get(values, x, y + step_size);
+    i8 d = get(values, x + step_size, y + step_size);
+
+    i8 e = (a + b + c + d) / 4 + var[0];
+
+    i8 f = get(values, x + half_step, y - half_step);
+    i8 g = get(values, x - half_step, y + half_step);
+
+    i8 h = (a + b + e + f) / 4 + var[1] / 2;
+    i8 i = (a + c + e + g) / 4 + var[2] / 2;
+
+    set(values, x + half_step, y + half_step, e);
+    set(values, x + half_step, y, h);
+    set(values, x, y + half_step, i);
+}
+
+// interior cells: no bounds checks ('p' points to sample a)
+static inline void noise_interior_cell(i8 *p, u32 step_size,
+                                       const i32 *var) {
+    const i32 half_step = step_size / 2;
+    const i32 down      = step_size * LEVEL_W;
+    const i32 half_down = half_step * LEVEL_W;
+
+    const i32 a = p[0];
+    const i32 b = p[step_size];
+    const i32 c = p[down];
+    const i32 d = p[down + step_size];
+
+    const i8 e = (a + b + c + d) / 4 + var[0];
+
+    const i8 f = p[half_step - half_down];
+    const i8 g = p[half_down - half_step];
+
+    p[half_down + half_step] = e;
+    p[half_step] = (a + b + e + f) / 4 + var[1] / 2;
+    p[half_down] = (a + c + e + g) / 4 + var[2] / 2;
+}
+
+// A cell of size 2 in an interior row. Its samples are adjacent, so they
+// are written two at a time: (a, h) in the row and (i, e) below it.
+// Returns e, which is g for the next cell.
+static inline i8 noise_step2_cell(i8 *row, u32 x, i32 b, i32 d, i32 g,
+                                  const i32 *var) {
+    const i32 a = row[x];
+    const i32 c = row[x + 2 * LEVEL_W];
+
+    const i8 e = (a + b + c + d) / 4 + var[0];
+    const i8 f = row[(i32) x + 1 - LEVEL_W];
+
+    const i8 h = (a + b + e + f) / 4 + var[1] / 2;
+    const i8 i = (a + c + e + g) / 4 + var[2] / 2;
+
+    *((u16 *) &row[x])           = (u8) a | (u8) h << 8;
+    *((u16 *) &row[x + LEVEL_W]) = (u8) i | (u8) e << 8;
+    return e;
+}
+
+static inline void cell_variations(i32 *var, u32 step_size) {
+    var[0] = variation(step_size);
+    var[1] = variation(step_size);
+    var[2] = variation(step_size);
+}
+
+static inline void noise_step2_row(i8 *row) {
+    i32 var[3];
+
+    // the left neighbor of the first cell is outside of the level
+    i32 g = 0;
+
+    u32 x = 0;
+    for(; x < LEVEL_W - 2; x += 2) {
+        cell_variations(var, 2);
+        g = noise_step2_cell(
+            row, x, row[x + 2], row[x + 2 + 2 * LEVEL_W], g, var
+        );
+    }
+
+    // the right neighbors of the last cell are outside of the level
+    cell_variations(var, 2);
+    noise_step2_cell(row, x, 0, 0, g, var);
+}
+
 IWRAM_SECTION
 static NO_INLINE i8 *noise(i8 *values, u32 feature_size) {
     for(u32 y = 0; y < LEVEL_H; y += feature_size)
@@ -41,34 +145,26 @@ static NO_INLINE i8 *noise(i8 *values, u32 feature_size) {
             set(values, x, y, random(256) - 128);
 
     for(u32 step_size = feature_size; step_size > 1; step_size /= 2) {
-        u32 half_step = step_size / 2;
-
         for(u32 y = 0; y < LEVEL_H; y += step_size) {
+            const bool is_interior_row = (y > 0 &&
+                                          y + step_size < LEVEL_H);
+
+            if(is_interior_row && step_size == 2) {
+                noise_step2_row(&values[y * LEVEL_W]);
+                continue;
+            }
+
             for(u32 x = 0; x < LEVEL_W; x += step_size) {
-                //     |     |
-                //        f
-                //     |     |
-                // - - a -h- b
-                //     |     |
-                //  g  i  e  |
-                //     |     |
-                // - - c --- d
-                i8 a = get(values, x, y);
-                i8 b = get(values, x + step_size, y);
-                i8 c = get(values, x, y + step_size);
-                i8 d = get(values, x + step_size, y + step_size);
-
-                i8 e = (a + b + c + d) / 4 + variation(step_size);
-
-                i8 f = get(values, x + half_step, y - half_step);
-                i8 g = get(values, x - half_step, y + half_step);
-
-                i8 h = (a + b + e + f) / 4 + variation(step_size) / 2;
-                i8 i = (a + c + e + g) / 4 + variation(step_size) / 2;
-
-                set(values, x + half_step, y + half_step, e);
-                set(values, x + half_step, y, h);
-                set(values, x, y + half_step, i);
+                i32 var[3];
+                cell_variations(var, step_size);
+
+                if(is_interior_row && x > 0 && x + step_size < LEVEL_W) {
+                    noise_interior_cell(
+                        &values[x + y * LEVEL_W], step_size, var
+                    );
+                } else {
+                    noise_edge_cell(values, x, y, step_size, var);
+                }
             }
         }
     }
@@ -80,338 +176,451 @@ static inline u32 abs(i32 val) {
     return (val ^ mask) + (mask & 1);
 }
 
-static inline bool generate_underground(u32 lvl) {
+// The falloff lowers the values far from the center of the level. It only
+// depends on the larger of the two distances from the center, so a table
+// with one entry per distance is shared by all levels.
+#define FALLOFF_SIZE (LEVEL_W / 2 + 1)
+
+static_assert(LEVEL_W == LEVEL_H, "the falloff table assumes square levels");
+
+static u16 falloff_table[FALLOFF_SIZE];
+
+static inline void init_falloff_table(void) {
+    for(u32 d = 0; d < FALLOFF_SIZE; d++) {
+        u32 dist = d * 256 / LEVEL_W;
+        dist = dist * dist * dist * dist / (128 * 128 * 128);
+        dist = dist * dist * dist * dist / (128 * 128 * 128);
+
+        falloff_table[d] = dist * 20;
+    }
+}
+
+static inline u32 get_falloff(u32 x, u32 y) {
+    // distance from center
+    u32 xd = abs(x - LEVEL_W / 2);
+    u32 yd = abs(y - LEVEL_H / 2);
+
+    return falloff_table[(xd >= yd) * xd + (xd < yd) * yd];
+}
+
+// Generation is a state machine: each call of 'generate_step' does one
+// phase (a noise pass or a placement phase) of the level being generated.
+// A phase returns one of these values.
+#define PHASE_NEXT   (0) // go on with the next phase
+#define PHASE_REJECT (1) // discard the attempt and start the level again
+#define PHASE_DONE   (2) // the level is complete
+
+// level 5 is made of the phases done after generating all levels
+#define FINAL_LVL (5)
+
+// number of phases of each level
+static const u8 phase_counts[6] = { 13, 13, 13, 11, 5, 3 };
+
+static u8 current_lvl;
+static u8 current_phase;
+
+// tile counts of the current attempt
+static struct {
+    u16 rock;
+    u16 dirt;
+    u16 ore;
+    u16 grass;
+    u16 sand;
+    u16 tree;
+    u16 cloud;
+    u16 stairs;
+} count;
+
+// the noise buffers are the data arrays of the levels
+#define NOISE_BUFFER(index) ((i8 *) &levels[(index)].data)
+
+static inline u32 underground_phase(u32 lvl) {
     struct Level *level = &levels[lvl];
 
-    u32 rock_count   = 0;
-    u32 dirt_count   = 0;
-    u32 ore_count    = 0;
-    u32 stairs_count = 0;
-
-    i8 *noise1 = noise((i8 *) &levels[0].data, 32);
-    i8 *noise2 = noise((i8 *) &levels[1].data, 32);
-
-    i8 *mnoise1 = noise((i8 *) &levels[2].data, 16);
-    i8 *mnoise2 = noise((i8 *) &levels[3].data, 16);
-    i8 *mnoise3 = noise((i8 *) &levels[4].data, 16);
-
-    i8 *nnoise1 = noise((i8 *) level_solid_entities + 1 * (LEVEL_W * LEVEL_H), 16);
-    i8 *nnoise2 = noise((i8 *) level_solid_entities + 2 * (LEVEL_W * LEVEL_H), 16);
-    i8 *nnoise3 = noise((i8 *) level_solid_entities + 3 * (LEVEL_W * LEVEL_H), 16);
-
-    i8 *wnoise3 = noise((i8 *) level_solid_entities + 4 * (LEVEL_W * LEVEL_H), 16);
-
-    for(u32 y = 0; y < LEVEL_H; y++) {
-        for(u32 x = 0; x < LEVEL_W; x++) {
-            u32 i = x + y * LEVEL_W;
-
-            i32 val = abs(noise1[i] - noise2[i]) * 3 - 256;
-            i32 mval = abs(abs(mnoise1[i] - mnoise2[i]) - mnoise3[i]) * 3 - 256;
-            i32 nval = abs(abs(nnoise1[i] - nnoise2[i]) - nnoise3[i]) * 3 - 256;
-            i32 wval = abs(nval - wnoise3[i]) * 3 - 256;
-
-            // distance from center
-            u32 xd = abs(x - LEVEL_W / 2) * 256 / LEVEL_W;
-            u32 yd = abs(y - LEVEL_H / 2) * 256 / LEVEL_H;
-
-            u32 dist = (xd >= yd) * xd + (xd < yd) * yd;
-            dist = dist * dist * dist * dist / (128 * 128 * 128);
-            dist = dist * dist * dist * dist / (128 * 128 * 128);
-            val += 128 - dist * 20;
-
-            if(val > -256 && wval < 384 * (lvl != 2) - 256) {
-                level->tiles[i] = LIQUID_TILE;
-            } else if(val > -256 && (mval < -218 || nval < -179)) {
-                level->tiles[i] = DIRT_TILE;
-                dirt_count++;
-            } else {
-                level->tiles[i] = ROCK_TILE;
-                rock_count++;
+    switch(current_phase) {
+        // noise1 and noise2
+        case 0: case 1:
+            noise(NOISE_BUFFER(current_phase), 32);
+            break;
+
+        // mnoise1, mnoise2 and mnoise3
+        case 2: case 3: case 4:
+            noise(NOISE_BUFFER(current_phase), 16);
+            break;
+
+        // There are only five noise buffers: reduce the first five noises
+        // to two flags, stored in 'noise1', then reuse the other buffers.
+        case 5: {
+            i8 *noise1 = NOISE_BUFFER(0);
+            i8 *noise2 = NOISE_BUFFER(1);
+
+            i8 *mnoise1 = NOISE_BUFFER(2);
+            i8 *mnoise2 = NOISE_BUFFER(3);
+            i8 *mnoise3 = NOISE_BUFFER(4);
+
+            for(u32 y = 0; y < LEVEL_H; y++) {
+                for(u32 x = 0; x < LEVEL_W; x++) {
+                    u32 i = x + y * LEVEL_W;
+
+                    i32 val = abs(noise1[i] - noise2[i]) * 3 - 256;
+                    i32 mval = abs(abs(mnoise1[i] - mnoise2[i]) - mnoise3[i]) * 3 - 256;
+
+                    val += 128 - get_falloff(x, y);
+
+                    noise1[i] = (val > -256) | (mval < -218) << 1;
+                }
             }
+            break;
         }
-    }
 
-    // add ores
-    for(u32 i = 0; i < LEVEL_W * LEVEL_H / 400; i++) {
-        // center of the ores
-        u32 xc = random(LEVEL_W);
-        u32 yc = random(LEVEL_H);
+        // nnoise1, nnoise2, nnoise3 and wnoise3
+        case 6: case 7: case 8: case 9:
+            noise(NOISE_BUFFER(current_phase - 5), 16);
+            break;
+
+        case 10: {
+            i8 *flags = NOISE_BUFFER(0);
+
+            i8 *nnoise1 = NOISE_BUFFER(1);
+            i8 *nnoise2 = NOISE_BUFFER(2);
+            i8 *nnoise3 = NOISE_BUFFER(3);
+
+            i8 *wnoise3 = NOISE_BUFFER(4);
 
-        for(u32 j = 0; j < 30; j++) {
-            i32 xt = xc + random(9) - 4;
-            i32 yt = yc + random(9) - 4;
+            for(u32 y = 0; y < LEVEL_H; y++) {
+                for(u32 x = 0; x < LEVEL_W; x++) {
+                    u32 i = x + y * LEVEL_W;
 
-            if(xt >= 2 && xt < LEVEL_W - 2 && yt >= 2 && yt < LEVEL_H - 2) {
-                if(level->tiles[xt + yt * LEVEL_W] == ROCK_TILE) {
-                    level->tiles[xt + yt * LEVEL_W] = (GEM_ORE_TILE - lvl);
+                    bool is_inside = flags[i] & 1;
+                    bool is_mdirt  = flags[i] & 2;
 
-                    ore_count++;
-                    rock_count--;
+                    i32 nval = abs(abs(nnoise1[i] - nnoise2[i]) - nnoise3[i]) * 3 - 256;
+                    i32 wval = abs(nval - wnoise3[i]) * 3 - 256;
+
+                    if(is_inside && wval < 384 * (lvl != 2) - 256) {
+                        level->tiles[i] = LIQUID_TILE;
+                    } else if(is_inside && (is_mdirt || nval < -179)) {
+                        level->tiles[i] = DIRT_TILE;
+                        count.dirt++;
+                    } else {
+                        level->tiles[i] = ROCK_TILE;
+                        count.rock++;
+                    }
                 }
             }
+
+            break;
         }
-    }
 
-    // add stairs down
-    if(lvl != 0) {
-        for(u32 i = 0; i < LEVEL_W * LEVEL_H / 100; i++) {
-            u32 xt = 10 + random(LEVEL_W - 20);
-            u32 yt = 10 + random(LEVEL_H - 20);
+        // add ores
+        case 11:
+            for(u32 i = 0; i < LEVEL_W * LEVEL_H / 400; i++) {
+                // center of the ores
+                u32 xc = random(LEVEL_W);
+                u32 yc = random(LEVEL_H);
+
+                for(u32 j = 0; j < 30; j++) {
+                    i32 xt = xc + random(9) - 4;
+                    i32 yt = yc + random(9) - 4;
+
+                    if(xt >= 2 && xt < LEVEL_W - 2 && yt >= 2 && yt < LEVEL_H - 2) {
+                        if(level->tiles[xt + yt * LEVEL_W] == ROCK_TILE) {
+                            level->tiles[xt + yt * LEVEL_W] = (GEM_ORE_TILE - lvl);
 
-            // check if there is rock all around
-            for(u32 y = yt - 1; y <= yt + 1; y++)
-                for(u32 x = xt - 1; x <= xt + 1; x++)
-                    if(level->tiles[x + y * LEVEL_W] != ROCK_TILE)
-                        goto continue_stairs_down;
+                            count.ore++;
+                            count.rock--;
+                        }
+                    }
+                }
+            }
+            break;
 
-            level->tiles[xt + yt * LEVEL_W] = STAIRS_DOWN_TILE;
+        // add stairs down
+        case 12:
+            if(lvl != 0) {
+                for(u32 i = 0; i < LEVEL_W * LEVEL_H / 100; i++) {
+                    u32 xt = 10 + random(LEVEL_W - 20);
+                    u32 yt = 10 + random(LEVEL_H - 20);
 
-            stairs_count++;
-            rock_count--;
+                    // check if there is rock all around
+                    for(u32 y = yt - 1; y <= yt + 1; y++)
+                        for(u32 x = xt - 1; x <= xt + 1; x++)
+                            if(level->tiles[x + y * LEVEL_W] != ROCK_TILE)
+                                goto continue_stairs_down;
 
-            if(stairs_count >= 4)
-                break;
+                    level->tiles[xt + yt * LEVEL_W] = STAIRS_DOWN_TILE;
 
-            continue_stairs_down:;
-        }
-    }
+                    count.stairs++;
+                    count.rock--;
+
+                    if(count.stairs >= 4)
+                        break;
+
+                    continue_stairs_down:;
+                }
+            }
 
-    return rock_count >= 100 && dirt_count >= 100 && ore_count >= 20 &&
-           (stairs_count >= 2 || lvl == 0);
+            if(count.rock < 100 || count.dirt < 100 || count.ore < 20 ||
+               (count.stairs < 2 && lvl != 0))
+                return PHASE_REJECT;
+            return PHASE_DONE;
+    }
+    return PHASE_NEXT;
 }
 
-static inline bool generate_top(void) {
+static inline u32 top_phase(void) {
     struct Level *level = &levels[3];
 
-    u32 rock_count   = 0;
-    u32 grass_count  = 0;
-    u32 sand_count   = 0;
-    u32 tree_count   = 0;
-    u32 stairs_count = 0;
-
-    i8 *noise1 = noise((i8 *) &levels[0].data, 32);
-    i8 *noise2 = noise((i8 *) &levels[1].data, 32);
-
-    i8 *mnoise1 = noise((i8 *) &levels[2].data, 16);
-    i8 *mnoise2 = noise((i8 *) &levels[3].data, 16);
-    i8 *mnoise3 = noise((i8 *) &levels[4].data, 16);
-
-    for(u32 y = 0; y < LEVEL_H; y++) {
-        for(u32 x = 0; x < LEVEL_W; x++) {
-            u32 i = x + y * LEVEL_W;
-
-            i32 val = abs(noise1[i] - noise2[i]) * 3 - 256;
-            i32 mval = abs(abs(mnoise1[i] - mnoise2[i]) - mnoise3[i]) * 3 - 256;
-
-            // distance from center
-            u32 xd = abs(x - LEVEL_W / 2) * 256 / LEVEL_W;
-            u32 yd = abs(y - LEVEL_H / 2) * 256 / LEVEL_H;
-
-            u32 dist = (xd >= yd) * xd + (xd < yd) * yd;
-            dist = dist * dist * dist * dist / (128 * 128 * 128);
-            dist = dist * dist * dist * dist / (128 * 128 * 128);
-            val += 128 - dist * 20;
-
-            if(val < -64) {
-                level->tiles[i] = LIQUID_TILE;
-            } else if(val > 64 && mval < -192) {
-                level->tiles[i] = ROCK_TILE;
-                rock_count++;
-            } else {
-                level->tiles[i] = GRASS_TILE;
-                grass_count++;
+    switch(current_phase) {
+        // noise1 and noise2
+        case 0: case 1:
+            noise(NOISE_BUFFER(current_phase), 32);
+            break;
+
+        // mnoise1, mnoise2 and mnoise3
+        case 2: case 3: case 4:
+            noise(NOISE_BUFFER(current_phase), 16);
+            break;
+
+        case 5: {
+            i8 *noise1 = NOISE_BUFFER(0);
+            i8 *noise2 = NOISE_BUFFER(1);
+
+            i8 *mnoise1 = NOISE_BUFFER(2);
+            i8 *mnoise2 = NOISE_BUFFER(3);
+            i8 *mnoise3 = NOISE_BUFFER(4);
+
+            for(u32 y = 0; y < LEVEL_H; y++) {
+                for(u32 x = 0; x < LEVEL_W; x++) {
+                    u32 i = x + y * LEVEL_W;
+
+                    i32 val = abs(noise1[i] - noise2[i]) * 3 - 256;
+                    i32 mval = abs(abs(mnoise1[i] - mnoise2[i]) - mnoise3[i]) * 3 - 256;
+
+                    val += 128 - get_falloff(x, y);
+
+                    if(val < -64) {
+                        level->tiles[i] = LIQUID_TILE;
+                    } else if(val > 64 && mval < -192) {
+                        level->tiles[i] = ROCK_TILE;
+                        count.rock++;
+                    } else {
+                        level->tiles[i] = GRASS_TILE;
+                        count.grass++;
+                    }
+                }
             }
+            break;
         }
-    }
 
-    // add deserts
-    for(u32 i = 0; i < LEVEL_W * LEVEL_H / 2800; i++) {
-        // center of the desert
-        u32 xc = random(LEVEL_W);
-        u32 yc = random(LEVEL_H);
+        // add deserts
+        case 6:
+            for(u32 i = 0; i < LEVEL_W * LEVEL_H / 2800; i++) {
+                // center of the desert
+                u32 xc = random(LEVEL_W);
+                u32 yc = random(LEVEL_H);
 
-        for(u32 j = 0; j < 10; j++) {
-            i32 xj = xc + random(21) - 10;
-            i32 yj = yc + random(21) - 10;
+                for(u32 j = 0; j < 10; j++) {
+                    i32 xj = xc + random(21) - 10;
+                    i32 yj = yc + random(21) - 10;
 
-            for(u32 k = 0; k < 85; k++) {
-                i32 xk = xj + random(9) - 4;
-                i32 yk = yj + random(9) - 4;
+                    for(u32 k = 0; k < 85; k++) {
+                        i32 xk = xj + random(9) - 4;
+                        i32 yk = yj + random(9) - 4;
 
-                for(i32 yt = yk - 1; yt <= yk + 1; yt++) {
-                    if(yt < 0 || yt >= LEVEL_H)
-                        continue;
+                        for(i32 yt = yk - 1; yt <= yk + 1; yt++) {
+                            if(yt < 0 || yt >= LEVEL_H)
+                                continue;
 
-                    for(i32 xt = xk - 1; xt <= xk + 1; xt++) {
-                        if(xt < 0 || xt >= LEVEL_W)
-                            continue;
+                            for(i32 xt = xk - 1; xt <= xk + 1; xt++) {
+                                if(xt < 0 || xt >= LEVEL_W)
+                                    continue;
 
-                        if(level->tiles[xt + yt * LEVEL_W] == GRASS_TILE) {
-                            level->tiles[xt + yt * LEVEL_W] = SAND_TILE;
+                                if(level->tiles[xt + yt * LEVEL_W] == GRASS_TILE) {
+                                    level->tiles[xt + yt * LEVEL_W] = SAND_TILE;
 
-                            sand_count++;
-                            grass_count--;
+                                    count.sand++;
+                                    count.grass--;
+                                }
+                            }
                         }
                     }
                 }
             }
-        }
-    }
 
-    // add forests
-    for(u32 i = 0; i < LEVEL_W * LEVEL_H / 400; i++) {
-        // center of the forest
-        u32 xc = random(LEVEL_W);
-        u32 yc = random(LEVEL_H);
+            break;
+
+        // add forests
+        case 7:
+            for(u32 i = 0; i < LEVEL_W * LEVEL_H / 400; i++) {
+                // center of the forest
+                u32 xc = random(LEVEL_W);
+                u32 yc = random(LEVEL_H);
 
-        for(u32 j = 0; j < 175; j++) {
-            i32 xt = xc + random(29) - 14;
-            i32 yt = yc + random(29) - 14;
+                for(u32 j = 0; j < 175; j++) {
+                    i32 xt = xc + random(29) - 14;
+                    i32 yt = yc + random(29) - 14;
 
-            if(xt >= 0 && xt < LEVEL_W && yt >= 0 && yt < LEVEL_H) {
-                if(level->tiles[xt + yt * LEVEL_W] == GRASS_TILE) {
-                    level->tiles[xt + yt * LEVEL_W] = TREE_TILE;
+                    if(xt >= 0 && xt < LEVEL_W && yt >= 0 && yt < LEVEL_H) {
+                        if(level->tiles[xt + yt * LEVEL_W] == GRASS_TILE) {
+                            level->tiles[xt + yt * LEVEL_W] = TREE_TILE;
 
-                    tree_count++;
-                    grass_count--;
+                            count.tree++;
+                            count.grass--;
+                        }
+                    }
                 }
             }
-        }
-    }
+            break;
 
-    // add flowers
-    for(u32 i = 0; i < LEVEL_W * LEVEL_H / 400; i++) {
-        // center of the flowers
-        u32 xc = random(LEVEL_W);
-        u32 yc = random(LEVEL_H);
+        // add flowers
+        case 8:
+            for(u32 i = 0; i < LEVEL_W * LEVEL_H / 400; i++) {
+                // center of the flowers
+                u32 xc = random(LEVEL_W);
+                u32 yc = random(LEVEL_H);
 
-        for(u32 j = 0; j < 30; j++) {
-            i32 xt = xc + random(9) - 4;
-            i32 yt = yc + random(9) - 4;
+                for(u32 j = 0; j < 30; j++) {
+                    i32 xt = xc + random(9) - 4;
+                    i32 yt = yc + random(9) - 4;
 
-            if(xt >= 0 && xt < LEVEL_W && yt >= 0 && yt < LEVEL_H) {
-                if(level->tiles[xt + yt * LEVEL_W] == GRASS_TILE) {
-                    level->tiles[xt + yt * LEVEL_W] = FLOWER_TILE;
+                    if(xt >= 0 && xt < LEVEL_W && yt >= 0 && yt < LEVEL_H) {
+                        if(level->tiles[xt + yt * LEVEL_W] == GRASS_TILE) {
+                            level->tiles[xt + yt * LEVEL_W] = FLOWER_TILE;
 
-                    grass_count--;
+                            count.grass--;
+                        }
+                    }
                 }
             }
-        }
-    }
+            break;
 
-    // add cactus
-    for(u32 i = 0; i < LEVEL_W * LEVEL_H / 100; i++) {
-        u32 xt = random(LEVEL_W);
-        u32 yt = random(LEVEL_H);
+        // add cactus
+        case 9:
+            for(u32 i = 0; i < LEVEL_W * LEVEL_H / 100; i++) {
+                u32 xt = random(LEVEL_W);
+                u32 yt = random(LEVEL_H);
 
-        if(level->tiles[xt + yt * LEVEL_W] == SAND_TILE) {
-            level->tiles[xt + yt * LEVEL_W] = CACTUS_TILE;
+                if(level->tiles[xt + yt * LEVEL_W] == SAND_TILE) {
+                    level->tiles[xt + yt * LEVEL_W] = CACTUS_TILE;
 
-            sand_count--;
-        }
-    }
+                    count.sand--;
+                }
+            }
+            break;
 
-    // add stairs down
-    for(u32 i = 0; i < LEVEL_W * LEVEL_H / 100; i++) {
-        u32 xt = 1 + random(LEVEL_W - 2);
-        u32 yt = 1 + random(LEVEL_H - 2);
+        // add stairs down
+        case 10:
+            for(u32 i = 0; i < LEVEL_W * LEVEL_H / 100; i++) {
+                u32 xt = 1 + random(LEVEL_W - 2);
+                u32 yt = 1 + random(LEVEL_H - 2);
 
-        // check if there is rock all around
-        for(u32 y = yt - 1; y <= yt + 1; y++)
-            for(u32 x = xt - 1; x <= xt + 1; x++)
-                if(level->tiles[x + y * LEVEL_W] != ROCK_TILE)
-                    goto continue_stairs_down;
+                // check if there is rock all around
+                for(u32 y = yt - 1; y <= yt + 1; y++)
+                    for(u32 x = xt - 1; x <= xt + 1; x++)
+                        if(level->tiles[x + y * LEVEL_W] != ROCK_TILE)
+                            goto continue_stairs_down;
 
-        level->tiles[xt + yt * LEVEL_W] = STAIRS_DOWN_TILE;
+                level->tiles[xt + yt * LEVEL_W] = STAIRS_DOWN_TILE;
 
-        stairs_count++;
-        rock_count--;
+                count.stairs++;
+                count.rock--;
 
-        if(stairs_count >= 4)
-            break;
+                if(count.stairs >= 4)
+                    break;
 
-        continue_stairs_down:;
-    }
+                continue_stairs_down:;
+            }
 
-    return rock_count >= 100 && grass_count >= 100 &&
-           sand_count >= 100 && tree_count  >= 100 &&
-           stairs_count >= 2;
+            if(count.rock < 100 || count.grass < 100 ||
+               count.sand < 100 || count.tree  < 100 ||
+               count.stairs < 2)
+                return PHASE_REJECT;
+            return PHASE_DONE;
+    }
+    return PHASE_NEXT;
 }
 
-static inline bool generate_sky(void) {
+static inline u32 sky_phase(void) {
     struct Level *level = &levels[4];
 
-    u32 cloud_count  = 0;
-    u32 stairs_count = 0;
-
-    i8 *noise1 = noise((i8 *) &levels[0].data, 8);
-    i8 *noise2 = noise((i8 *) &levels[1].data, 8);
+    switch(current_phase) {
+        // noise1 and noise2
+        case 0: case 1:
+            noise(NOISE_BUFFER(current_phase), 8);
+            break;
 
-    for(u32 y = 0; y < LEVEL_H; y++) {
-        for(u32 x = 0; x < LEVEL_W; x++) {
-            u32 i = x + y * LEVEL_W;
+        case 2: {
+            i8 *noise1 = NOISE_BUFFER(0);
+            i8 *noise2 = NOISE_BUFFER(1);
 
-            i32 val = abs(noise1[i] - noise2[i]) * 3 - 256;
+            for(u32 y = 0; y < LEVEL_H; y++) {
+                for(u32 x = 0; x < LEVEL_W; x++) {
+                    u32 i = x + y * LEVEL_W;
 
-            // distance from center
-            u32 xd = abs(x - LEVEL_W / 2) * 256 / LEVEL_W;
-            u32 yd = abs(y - LEVEL_H / 2) * 256 / LEVEL_H;
+                    i32 val = abs(noise1[i] - noise2[i]) * 3 - 256;
 
-            u32 dist = (xd >= yd) * xd + (xd < yd) * yd;
-            dist = dist * dist * dist * dist / (128 * 128 * 128);
-            dist = dist * dist * dist * dist / (128 * 128 * 128);
-            val = -val - 282;
-            val += 128 - dist * 20;
+                    val = -val - 282;
+                    val += 128 - get_falloff(x, y);
 
-            if(val < -32) {
-                level->tiles[i] = INFINITE_FALL_TILE;
-            } else {
-                level->tiles[i] = CLOUD_TILE;
-                cloud_count++;
+                    if(val < -32) {
+                        level->tiles[i] = INFINITE_FALL_TILE;
+                    } else {
+                        level->tiles[i] = CLOUD_TILE;
+                        count.cloud++;
+                    }
+                }
             }
+            break;
         }
-    }
 
-    // add cloud cactus
-    for(u32 i = 0; i < LEVEL_W * LEVEL_H / 50; i++) {
-        u32 xt = 1 + random(LEVEL_W - 2);
-        u32 yt = 1 + random(LEVEL_H - 2);
+        // add cloud cactus
+        case 3:
+            for(u32 i = 0; i < LEVEL_W * LEVEL_H / 50; i++) {
+                u32 xt = 1 + random(LEVEL_W - 2);
+                u32 yt = 1 + random(LEVEL_H - 2);
 
-        // check if there is cloud all around
-        for(u32 y = yt - 1; y <= yt + 1; y++)
-            for(u32 x = xt - 1; x <= xt + 1; x++)
-                if(level->tiles[x + y * LEVEL_W] != CLOUD_TILE)
-                    goto continue_cloud_cactus;
+                // check if there is cloud all around
+                for(u32 y = yt - 1; y <= yt + 1; y++)
+                    for(u32 x = xt - 1; x <= xt + 1; x++)
+                        if(level->tiles[x + y * LEVEL_W] != CLOUD_TILE)
+                            goto continue_cloud_cactus;
 
-        level->tiles[xt + yt * LEVEL_W] = CLOUD_CACTUS_TILE;
-        cloud_count--;
+                level->tiles[xt + yt * LEVEL_W] = CLOUD_CACTUS_TILE;
+                count.cloud--;
 
-        continue_cloud_cactus:;
-    }
+                continue_cloud_cactus:;
+            }
+            break;
+
+        // add stairs down
+        case 4:
+            for(u32 i = 0; i < LEVEL_W * LEVEL_H / 100; i++) {
+                u32 xt = 1 + random(LEVEL_W - 2);
+                u32 yt = 1 + random(LEVEL_H - 2);
 
-    // add stairs down
-    for(u32 i = 0; i < LEVEL_W * LEVEL_H / 100; i++) {
-        u32 xt = 1 + random(LEVEL_W - 2);
-        u32 yt = 1 + random(LEVEL_H - 2);
+                // check if there is cloud all around
+                for(u32 y = yt - 1; y <= yt + 1; y++)
+                    for(u32 x = xt - 1; x <= xt + 1; x++)
+                        if(level->tiles[x + y * LEVEL_W] != CLOUD_TILE)
+                            goto continue_stairs_down;
 
-        // check if there is cloud all around
-        for(u32 y = yt - 1; y <= yt + 1; y++)
-            for(u32 x = xt - 1; x <= xt + 1; x++)
-                if(level->tiles[x + y * LEVEL_W] != CLOUD_TILE)
-                    goto continue_stairs_down;
+                level->tiles[xt + yt * LEVEL_W] = STAIRS_DOWN_TILE;
 
-        level->tiles[xt + yt * LEVEL_W] = STAIRS_DOWN_TILE;
+                count.stairs++;
+                count.cloud--;
 
-        stairs_count++;
-        cloud_count--;
+                if(count.stairs >= 4)
+                    break;
 
-        if(stairs_count >= 4)
-            break;
+                continue_stairs_down:;
+            }
 
-        continue_stairs_down:;
+            if(count.cloud < 1750 || count.stairs < 2)
+                return PHASE_REJECT;
+            return PHASE_DONE;
     }
-
-    return cloud_count >= 1750 && stairs_count >= 2;
+    return PHASE_NEXT;
 }
 
 static inline void generate_stairs_up(void) {
@@ -470,15 +679,95 @@ static inline void generate_entities(void) {
     entity_add_air_wizard(&levels[4]);
 }
 
-void generate_levels(void) {
-    while(!generate_underground(0));
-    while(!generate_underground(1));
-    while(!generate_underground(2));
-    while(!generate_top());
-    while(!generate_sky());
+static inline u32 final_phase(void) {
+    switch(current_phase) {
+        case 0:
+            generate_stairs_up();
+            break;
+
+        case 1:
+            generate_data();
+            break;
+
+        case 2:
+            generate_entities();
+            return PHASE_DONE;
+    }
+    return PHASE_NEXT;
+}
+
+static inline void begin_attempt(void) {
+    current_phase = 0;
+    count = (typeof(count)) { 0 };
+}
+
+void generate_begin(void) {
+    init_falloff_table();
 
-    generate_stairs_up();
-    generate_data();
+    current_lvl = 0;
+    begin_attempt();
 
-    generate_entities();
+    generator_attempts[0] = 1;
+    generator_cycles[0] = 0;
+}
+
+bool generate_step(void) {
+    if(current_lvl > FINAL_LVL)
+        return true;
+
+    const u32 start_cycles = performance_cycles();
+
+    u32 result;
+    switch(current_lvl) {
+        case 3:
+            result = top_phase();
+            break;
+        case 4:
+            result = sky_phase();
+            break;
+        case FINAL_LVL:
+            result = final_phase();
+            break;
+        default:
+            result = underground_phase(current_lvl);
+            break;
+    }
+
+    if(current_lvl < FINAL_LVL)
+        generator_cycles[current_lvl] += performance_cycles() - start_cycles;
+
+    if(result == PHASE_NEXT) {
+        current_phase++;
+    } else if(result == PHASE_REJECT) {
+        generator_attempts[current_lvl]++;
+        begin_attempt();
+    } else {
+        current_lvl++;
+        begin_attempt();
+
+        if(current_lvl < FINAL_LVL) {
+            generator_attempts[current_lvl] = 1;
+            generator_cycles[current_lvl] = 0;
+        }
+    }
+    return current_lvl > FINAL_LVL;
+}
+
+u32 generate_progress(void) {
+    u32 total = 0;
+    u32 done = 0;
+    for(u32 l = 0; l <= FINAL_LVL; l++) {
+        if(l < current_lvl)
+            done += phase_counts[l];
+        else if(l == current_lvl)
+            done += current_phase;
+
+        total += phase_counts[l];
+    }
+    return done * 100 / total;
+}
+
+void generate_levels(void) {
+    generate_begin();
+    while(!generate_step());
 }
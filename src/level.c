@@ -19,38 +19,267 @@
 #include "tile.h"
 #include "entity.h"
 #include "player.h"
+#include "performance.h"
 
 #include "tick/tiles.c"
 
 #include "draw/tiles.c"
 #include "draw/sort_entities.c"
+#include "draw/sprite_budget.c"
+#include "draw/lava_light.c"
 
 SBSS_SECTION
 struct Level levels[5];
 
+// Hash table of the tiles that contain at least one solid entity, using
+// linear probing. There can never be more than ENTITY_LIMIT such tiles.
+#define SOLID_TILES_TABLE_BITS (9)
+#define SOLID_TILES_TABLE_SIZE (1 << SOLID_TILES_TABLE_BITS)
+#define SOLID_TILES_TABLE_MASK (SOLID_TILES_TABLE_SIZE - 1)
+
+#define SOLID_TILE_EMPTY (0xffff)
+
+static_assert(
+    SOLID_TILES_TABLE_SIZE >= 2 * ENTITY_LIMIT,
+    "solid tiles table is too small"
+);
+
+struct SolidTile {
+    u16 tile;
+    u8 entities[SOLID_ENTITIES_IN_TILE];
+};
+
 SBSS_SECTION
-u8 level_solid_entities[LEVEL_W * LEVEL_H][SOLID_ENTITIES_IN_TILE];
+static struct SolidTile solid_tiles[SOLID_TILES_TABLE_SIZE];
+
+static const u8 no_solid_entities[SOLID_ENTITIES_IN_TILE] = {
+    [0 ... SOLID_ENTITIES_IN_TILE - 1] = -1
+};
+
+u8 level_live_entities[ENTITY_LIMIT];
+u32 level_live_entity_count = 0;
 
 u32 level_x_offset = 0;
 u32 level_y_offset = 0;
 
-static u8 entities_render_buffer[128];
+// BG0HOFS, BG0VOFS, BG1HOFS, BG1VOFS, BG2HOFS and BG2VOFS
+#define BG_OFFSETS ((vu32 *) 0x04000010)
+
+static u8 entities_render_buffer[ENTITY_LIMIT];
+static u8 entities_query_buffer[ENTITY_LIMIT];
+
+// The light layer (BG2) is composed here, then uploaded to VRAM during
+// VBlank. Each word holds two tilemap entries.
+static u32 light_buffer[32 * 20 / 2];
+static u8 lit_lanterns[ENTITY_LIMIT];
+
+// The level tiles (BG1) are also drawn into a RAM copy and uploaded in the
+// same VBlank as the light layer and the sprites. The offsets of BG0, BG1
+// and BG2 are written together in that VBlank: this way, all layers move
+// in the same frame.
+static u32 tilemap_buffer[32 * 32 / 2];
+static bool tilemap_changed = false;
+static u32 bg_offsets[3];
+
+#define ENTITY_BITMAP_WORDS ((ENTITY_LIMIT + 31) / 32)
+
+// Free entity slots of the loaded level: bit 'i' is set if 'entities[i]'
+// is free. Slot 0 is reserved for the player and is never marked free.
+static u32 free_entity_slots[ENTITY_BITMAP_WORDS];
+
+// Grid of cells, each one containing a doubly linked list of the live
+// entities whose position is inside that cell.
+#define CELL_COUNT (LEVEL_CELLS_W * LEVEL_CELLS_H)
+static u8 cell_first_entity[CELL_COUNT];
+static u8 cell_next_entity[ENTITY_LIMIT];
+static u8 cell_prev_entity[ENTITY_LIMIT];
+static u16 entity_cell[ENTITY_LIMIT];
+
+// must be at least the largest radius of an entity
+#define CELL_QUERY_MARGIN (8)
+
+// Only the tiles that can change when ticked (see 'is_tile_active') are
+// ticked. Each of them is kept in a timer wheel: the slots are lists of
+// tiles, linked through 'tile_wheel_next'.
+#define TILE_WHEEL_SIZE (512)
+
+#define TILE_NOT_SCHEDULED (0xffff)
+#define TILE_WHEEL_END     (0xfffe)
+
+SBSS_SECTION
+static u16 tile_wheel_next[LEVEL_W * LEVEL_H];
+
+static u16 tile_wheel[TILE_WHEEL_SIZE];
+
+static u32 entity_tick_time = 0;
+static u32 tile_wheel_time = 0;
+
+// Picking LEVEL_W * LEVEL_H / 50 random tiles every tick, as Minicraft
+// does, ticks each tile once every ~50.18 ticks, with geometrically
+// distributed intervals. This table samples that distribution.
+static const u16 tile_tick_delays[256] = {
+      1,   1,   1,   1,   1,   2,   2,   2,   2,   2,   3,   3,   3,   3,   3,   4,
+      4,   4,   4,   4,   5,   5,   5,   5,   5,   6,   6,   6,   6,   7,   7,   7,
+      7,   7,   8,   8,   8,   8,   9,   9,   9,   9,  10,  10,  10,  10,  10,  11,
+     11,  11,  11,  12,  12,  12,  12,  13,  13,  13,  13,  14,  14,  14,  14,  15,
+     15,  15,  15,  16,  16,  16,  17,  17,  17,  17,  18,  18,  18,  18,  19,  19,
+     19,  20,  20,  20,  20,  21,  21,  21,  22,  22,  22,  22,  23,  23,  23,  24,
+     24,  24,  25,  25,  25,  26,  26,  26,  27,  27,  27,  28,  28,  28,  29,  29,
+     29,  30,  30,  30,  31,  31,  31,  32,  32,  32,  33,  33,  34,  34,  34,  35,
+     35,  36,  36,  36,  37,  37,  38,  38,  38,  39,  39,  40,  40,  40,  41,  41,
+     42,  42,  43,  43,  44,  44,  45,  45,  45,  46,  46,  47,  47,  48,  48,  49,
+     49,  50,  51,  51,  52,  52,  53,  53,  54,  54,  55,  56,  56,  57,  57,  58,
+     59,  59,  60,  61,  61,  62,  62,  63,  64,  65,  65,  66,  67,  67,  68,  69,
+     70,  71,  71,  72,  73,  74,  75,  76,  76,  77,  78,  79,  80,  81,  82,  83,
+     84,  85,  86,  87,  89,  90,  91,  92,  93,  95,  96,  97,  99, 100, 102, 103,
+    105, 106, 108, 110, 111, 113, 115, 117, 119, 121, 124, 126, 128, 131, 134, 137,
+    140, 143, 147, 150, 155, 159, 164, 170, 176, 183, 191, 201, 214, 230, 256, 310
+};
+
+// BG1 is a ring buffer of 16x16 level tiles: each level tile is always
+// drawn in the same place, so scrolling only needs to draw the newly
+// exposed rows and columns.
+#define TILEMAP_RING_SIZE (16)
+
+#define VISIBLE_TILES_W (16)
+#define VISIBLE_TILES_H (10)
+
+// visible tiles that changed since the last frame
+#define DIRTY_TILES_LIMIT (64)
+
+static bool tilemap_valid = false;
+static u32 tilemap_x0;
+static u32 tilemap_y0;
+static u32 tilemap_tick;
+
+static u16 dirty_tiles[DIRTY_TILES_LIMIT];
+static u32 dirty_tile_count = 0;
+
+static struct Level *loaded_level = NULL;
+
+static inline void release_entity_slot(u8 entity_id) {
+    if(entity_id != 0)
+        free_entity_slots[entity_id / 32] |= 1u << (entity_id % 32);
+}
+
+// Keep 'level_live_entities' sorted by ID, so that entities are
+// iterated in the same order as the 'entities' array.
+static inline void insert_live_entity(u8 entity_id) {
+    u32 i = level_live_entity_count;
+    for(; i > 0 && level_live_entities[i - 1] > entity_id; i--)
+        level_live_entities[i] = level_live_entities[i - 1];
+
+    level_live_entities[i] = entity_id;
+    level_live_entity_count++;
+}
+
+static inline void remove_live_entity(u32 index) {
+    level_live_entity_count--;
+    for(u32 i = index; i < level_live_entity_count; i++)
+        level_live_entities[i] = level_live_entities[i + 1];
+}
+
+static inline u32 get_entity_cell(struct entity_Data *data) {
+    u32 xc = data->x / (LEVEL_CELL_SIZE * 16);
+    u32 yc = data->y / (LEVEL_CELL_SIZE * 16);
+
+    // particles can be slightly outside of the level
+    if(xc >= LEVEL_CELLS_W) xc = LEVEL_CELLS_W - 1;
+    if(yc >= LEVEL_CELLS_H) yc = LEVEL_CELLS_H - 1;
+
+    return xc + yc * LEVEL_CELLS_W;
+}
+
+static inline void insert_cell_entity(u32 cell, u8 entity_id) {
+    const u8 first = cell_first_entity[cell];
+
+    cell_next_entity[entity_id] = first;
+    cell_prev_entity[entity_id] = -1;
+    if(first < ENTITY_LIMIT)
+        cell_prev_entity[first] = entity_id;
+
+    cell_first_entity[cell] = entity_id;
+    entity_cell[entity_id] = cell;
+}
+
+static inline void remove_cell_entity(u8 entity_id) {
+    const u8 next = cell_next_entity[entity_id];
+    const u8 prev = cell_prev_entity[entity_id];
+
+    if(prev < ENTITY_LIMIT)
+        cell_next_entity[prev] = next;
+    else
+        cell_first_entity[entity_cell[entity_id]] = next;
+
+    if(next < ENTITY_LIMIT)
+        cell_prev_entity[next] = prev;
+}
+
+static inline u32 solid_tile_hash(u32 tile) {
+    return (tile * 2654435761u) >> (32 - SOLID_TILES_TABLE_BITS);
+}
+
+// Returns the position of 'tile' in the table or, if the tile is not
+// present, the position of the empty entry where it should be added.
+static inline u32 find_solid_tile(u32 tile) {
+    u32 pos = solid_tile_hash(tile);
+    while(solid_tiles[pos].tile != tile &&
+          solid_tiles[pos].tile != SOLID_TILE_EMPTY)
+        pos = (pos + 1) & SOLID_TILES_TABLE_MASK;
+    return pos;
+}
+
+static inline void delete_solid_tile(u32 hole) {
+    // move back the entries that would no longer be reachable
+    u32 pos = hole;
+    while(true) {
+        pos = (pos + 1) & SOLID_TILES_TABLE_MASK;
+        if(solid_tiles[pos].tile == SOLID_TILE_EMPTY)
+            break;
+
+        const u32 home = solid_tile_hash(solid_tiles[pos].tile);
+        if(((pos - home) & SOLID_TILES_TABLE_MASK) >=
+           ((pos - hole) & SOLID_TILES_TABLE_MASK)) {
+            solid_tiles[hole] = solid_tiles[pos];
+            hole = pos;
+        }
+    }
+    solid_tiles[hole].tile = SOLID_TILE_EMPTY;
+}
 
 static inline void remove_solid_entity(u8 xt, u8 yt,
                                        struct entity_Data *entity_data,
                                        u8 entity_id) {
-    const u32 tile = xt + yt * LEVEL_W;
-    if(level_solid_entities[tile][entity_data->solid_id] == entity_id)
-        level_solid_entities[tile][entity_data->solid_id] = -1;
+    const u32 pos = find_solid_tile(xt + yt * LEVEL_W);
+    struct SolidTile *solid_tile = &solid_tiles[pos];
+    if(solid_tile->tile == SOLID_TILE_EMPTY)
+        return;
+
+    if(solid_tile->entities[entity_data->solid_id] != entity_id)
+        return;
+    solid_tile->entities[entity_data->solid_id] = -1;
+
+    for(u32 i = 0; i < SOLID_ENTITIES_IN_TILE; i++)
+        if(solid_tile->entities[i] < ENTITY_LIMIT)
+            return;
+    delete_solid_tile(pos);
 }
 
 static inline void insert_solid_entity(u8 xt, u8 yt,
                                        struct entity_Data *entity_data,
                                        u8 entity_id) {
     const u32 tile = xt + yt * LEVEL_W;
+
+    struct SolidTile *solid_tile = &solid_tiles[find_solid_tile(tile)];
+    if(solid_tile->tile == SOLID_TILE_EMPTY) {
+        solid_tile->tile = tile;
+        for(u32 i = 0; i < SOLID_ENTITIES_IN_TILE; i++)
+            solid_tile->entities[i] = -1;
+    }
+
     for(u32 i = 0; i < SOLID_ENTITIES_IN_TILE; i++) {
-        if(level_solid_entities[tile][i] >= ENTITY_LIMIT) {
-            level_solid_entities[tile][i] = entity_id;
+        if(solid_tile->entities[i] >= ENTITY_LIMIT) {
+            solid_tile->entities[i] = entity_id;
             entity_data->solid_id = i;
 
             break;
@@ -58,155 +287,521 @@ static inline void insert_solid_entity(u8 xt, u8 yt,
     }
 }
 
-void level_load(struct Level *level) {
-    for(u32 t = 0; t < LEVEL_W * LEVEL_H; t++)
-        for(u32 i = 0; i < SOLID_ENTITIES_IN_TILE; i++)
-            level_solid_entities[t][i] = -1;
+IWRAM_SECTION
+const u8 *level_get_solid_entities(u32 tile) {
+    const u32 pos = find_solid_tile(tile);
+    if(solid_tiles[pos].tile == SOLID_TILE_EMPTY)
+        return no_solid_entities;
+    return solid_tiles[pos].entities;
+}
+
+static inline void schedule_tile(u32 tile) {
+    if(tile_wheel_next[tile] != TILE_NOT_SCHEDULED)
+        return;
+
+    const u32 slot = (tile_wheel_time + tile_tick_delays[random(256)]) %
+                     TILE_WHEEL_SIZE;
+
+    tile_wheel_next[tile] = tile_wheel[slot];
+    tile_wheel[slot] = tile;
+}
 
+static inline void try_schedule_tile(struct Level *level, u32 xt, u32 yt) {
+    if(xt >= LEVEL_W || yt >= LEVEL_H)
+        return;
+
+    if(is_tile_active(level, xt, yt))
+        schedule_tile(xt + yt * LEVEL_W);
+}
+
+static inline void update_offset(struct Level *level) {
+    struct entity_Data *player = &level->entities[0];
+    if(player->type < ENTITY_TYPES) {
+        i32 x_offset = player->x - DISPLAY_WIDTH / 2;
+        i32 y_offset = player->y - DISPLAY_HEIGHT / 2 + 4;
+
+        if(x_offset < 16) x_offset = 16;
+        if(y_offset < 16) y_offset = 16;
+
+        if(x_offset > LEVEL_W * 16 - DISPLAY_WIDTH - 16)
+            x_offset = LEVEL_W * 16 - DISPLAY_WIDTH - 16;
+
+        if(y_offset > LEVEL_H * 16 - DISPLAY_HEIGHT - 16)
+            y_offset = LEVEL_H * 16 - DISPLAY_HEIGHT - 16;
+
+        level_x_offset = x_offset;
+        level_y_offset = y_offset;
+
+        // sky background offset
+        bg_offsets[0] = ((level_x_offset >> 2) & 0x7) |
+                        ((level_y_offset >> 2) & 0x7) << 16;
+
+        // level tiles offset (the tilemap is a ring buffer)
+        bg_offsets[1] = (level_x_offset % (TILEMAP_RING_SIZE * 16)) |
+                        (level_y_offset % (TILEMAP_RING_SIZE * 16)) << 16;
+
+        // light offset
+        bg_offsets[2] = (level_x_offset & 0xf) | (level_y_offset & 0xf) << 16;
+    }
+}
+
+// 'level_load_step' loads this many rows of tiles at a time, after the
+// visible rows and the entities
+#define LOAD_STEP_ROWS (16)
+#define LOAD_STEPS (2 + LEVEL_H / LOAD_STEP_ROWS)
+
+static_assert(
+    LEVEL_H % LOAD_STEP_ROWS == 0,
+    "LEVEL_H is not a multiple of LOAD_STEP_ROWS"
+);
+
+static u32 load_step = LOAD_STEPS;
+
+// rows whose tile masks and lava light are ready
+static bool row_loaded[LEVEL_H];
+
+// rows visible when the loading began, which are loaded first
+static u32 visible_y0;
+static u32 visible_y1;
+
+// Computes the tile masks and, in level 0, the lava light of the rows
+// from 'y0' to 'y1' (excluded).
+static inline void load_rows(struct Level *level, u32 y0, u32 y1) {
+    if(y0 >= y1)
+        return;
+
+    load_tile_masks(level, y0, y1);
+    if(level == &levels[0])
+        load_lava_light(level, y0, y1);
+
+    for(u32 yt = y0; yt < y1; yt++)
+        row_loaded[yt] = true;
+}
+
+static inline bool are_visible_rows_loaded(void) {
+    const u32 y0 = level_y_offset >> 4;
+    for(u32 yt = y0; yt < y0 + VISIBLE_TILES_H; yt++)
+        if(!row_loaded[yt])
+            return false;
+    return true;
+}
+
+void level_load_begin(struct Level *level) {
+    loaded_level = level;
+
+    for(u32 w = 0; w < ENTITY_BITMAP_WORDS; w++)
+        free_entity_slots[w] = 0;
+
+    level_live_entity_count = 0;
+
+    for(u32 c = 0; c < CELL_COUNT; c++)
+        cell_first_entity[c] = -1;
+
+    // restart the timers, so that a level always ticks the same way
+    // after being loaded (replays depend on this)
+    entity_tick_time = 0;
+    tile_wheel_time = 0;
+
+    // tile masks and lava light are computed by 'level_load_step'
+    for(u32 yt = 0; yt < LEVEL_H; yt++)
+        row_loaded[yt] = false;
+
+    update_offset(level);
+    visible_y0 = level_y_offset >> 4;
+    visible_y1 = visible_y0 + VISIBLE_TILES_H;
+
+    tilemap_valid = false;
+    dirty_tile_count = 0;
+
+    // solid entities are inserted by 'level_load_step'
     for(u32 i = 0; i < ENTITY_LIMIT; i++) {
         struct entity_Data *data = &level->entities[i];
 
-        if(data->type < ENTITY_TYPES)
-            level_add_entity(level, i);
+        if(data->type < ENTITY_TYPES) {
+            data->should_remove = false;
+
+            insert_live_entity(i);
+            insert_cell_entity(get_entity_cell(data), i);
+        }
+    }
+
+    load_step = 0;
+}
+
+bool level_load_step(void) {
+    if(load_step >= LOAD_STEPS)
+        return true;
+
+    struct Level *level = loaded_level;
+    if(load_step == 0) {
+        load_rows(level, visible_y0, visible_y1);
+    } else if(load_step == 1) {
+        for(u32 i = 0; i < SOLID_TILES_TABLE_SIZE; i++)
+            solid_tiles[i].tile = SOLID_TILE_EMPTY;
+
+        for(u32 i = 0; i < ENTITY_LIMIT; i++) {
+            struct entity_Data *data = &level->entities[i];
+
+            if(data->type >= ENTITY_TYPES)
+                release_entity_slot(i);
+            else if(ENTITY_S(data)->is_solid)
+                insert_solid_entity(data->x >> 4, data->y >> 4, data, i);
+        }
+
+        for(u32 i = 0; i < TILE_WHEEL_SIZE; i++)
+            tile_wheel[i] = TILE_WHEEL_END;
+    } else {
+        const u32 y0 = (load_step - 2) * LOAD_STEP_ROWS;
+        const u32 y1 = y0 + LOAD_STEP_ROWS;
+
+        // the rows that are not visible
+        load_rows(level, y0, (y1 < visible_y0) ? y1 : visible_y0);
+        load_rows(level, (y0 > visible_y1) ? y0 : visible_y1, y1);
+
+        // tiles are scheduled in order, as that consumes random numbers
+        for(u32 t = y0 * LEVEL_W; t < y1 * LEVEL_W; t++)
+            tile_wheel_next[t] = TILE_NOT_SCHEDULED;
+
+        for(u32 yt = y0; yt < y1; yt++)
+            for(u32 xt = 0; xt < LEVEL_W; xt++)
+                try_schedule_tile(level, xt, yt);
     }
+
+    load_step++;
+    return load_step >= LOAD_STEPS;
+}
+
+void level_load(struct Level *level) {
+    level_load_begin(level);
+    while(!level_load_step());
 }
 
 static inline void tick_tiles(struct Level *level) {
-    for(u32 i = 0; i < LEVEL_W * LEVEL_H / 50; i++) {
-        u32 xt = random(LEVEL_W);
-        u32 yt = random(LEVEL_H);
+    tile_wheel_time++;
+
+    const u32 slot = tile_wheel_time % TILE_WHEEL_SIZE;
+    u16 tile = tile_wheel[slot];
+    tile_wheel[slot] = TILE_WHEEL_END;
+
+    while(tile != TILE_WHEEL_END) {
+        const u16 next = tile_wheel_next[tile];
+        tile_wheel_next[tile] = TILE_NOT_SCHEDULED;
 
-        tick_tile(level, xt, yt);
+        const u32 xt = tile % LEVEL_W;
+        const u32 yt = tile / LEVEL_W;
+
+        // the tile may have changed since it was scheduled
+        if(is_tile_active(level, xt, yt)) {
+            tick_tile(level, xt, yt);
+            try_schedule_tile(level, xt, yt);
+        }
+
+        tile = next;
     }
 }
 
+// Marks a tile and its 8 neighbors, whose masks may have changed, to be
+// drawn again if they are visible.
+static inline void mark_tiles_dirty(u32 xt, u32 yt) {
+    if(!tilemap_valid)
+        return;
+
+    for(u32 y = yt - 1; y != yt + 2; y++) {
+        if(y - tilemap_y0 >= VISIBLE_TILES_H)
+            continue;
+
+        for(u32 x = xt - 1; x != xt + 2; x++) {
+            if(x - tilemap_x0 >= VISIBLE_TILES_W)
+                continue;
+
+            // if there are too many, draw all tiles again
+            if(dirty_tile_count == DIRTY_TILES_LIMIT) {
+                tilemap_valid = false;
+                return;
+            }
+            dirty_tiles[dirty_tile_count++] = x + y * LEVEL_W;
+        }
+    }
+}
+
+IWRAM_SECTION
+void level_tile_changed(struct Level *level, u32 xt, u32 yt) {
+    if(level != loaded_level)
+        return;
+
+    update_tile_masks(level, xt, yt);
+    mark_tiles_dirty(xt, yt);
+
+    if(level == &levels[0])
+        update_lava_light(level, xt, yt);
+
+    // a tile can also activate its neighbors (e.g. dirt next to grass)
+    try_schedule_tile(level, xt, yt);
+    try_schedule_tile(level, xt - 1, yt);
+    try_schedule_tile(level, xt + 1, yt);
+    try_schedule_tile(level, xt, yt - 1);
+    try_schedule_tile(level, xt, yt + 1);
+}
+
+// Returns how many ticks should pass between two updates of an entity,
+// or 0 if the entity should not be updated.
+static inline u32 get_tick_period(struct Level *level,
+                                  struct entity_Data *data) {
+    switch(data->type) {
+        case ZOMBIE_ENTITY:
+        case SLIME_ENTITY:
+        case ITEM_ENTITY:
+            break;
+
+        default:
+            return 1;
+    }
+
+    struct entity_Data *player = &level->entities[0];
+    if(player->type >= ENTITY_TYPES)
+        return 1;
+
+    u32 xd = (data->x > player->x) ? data->x - player->x : player->x - data->x;
+    u32 yd = (data->y > player->y) ? data->y - player->y : player->y - data->y;
+    u32 dist = (xd > yd) ? xd : yd;
+
+    if(dist < ENTITY_LOD_NEAR_DISTANCE)
+        return 1;
+    if(dist < ENTITY_LOD_FAR_DISTANCE)
+        return 2;
+    if(ENTITY_LOD_FREEZE_DISTANCE != 0 && dist >= ENTITY_LOD_FREEZE_DISTANCE)
+        return 0;
+    return 4;
+}
+
 static inline void tick_entities(struct Level *level) {
-    for(u32 i = 0; i < ENTITY_LIMIT; i++) {
+    entity_tick_time++;
+
+    u32 index = 0;
+    while(index < level_live_entity_count) {
+        const u8 i = level_live_entities[index];
         struct entity_Data *entity_data = &level->entities[i];
-        if(entity_data->type >= ENTITY_TYPES)
-            continue;
 
         u32 xt0 = entity_data->x >> 4;
         u32 yt0 = entity_data->y >> 4;
 
+        // the entity ID spreads updates of far entities across ticks
+        const u32 period = get_tick_period(level, entity_data);
+        if(period == 0 || (entity_tick_time + i) % period != 0) {
+            index++;
+            continue;
+        }
+
+        const u8 type = entity_data->type;
         const struct Entity *entity = ENTITY_S(entity_data);
-        entity->tick(level, entity_data);
+
+        entity_tick_scale = period;
+        if(performance_entity_timing) {
+            const u32 start_cycles = performance_cycles();
+            entity->tick(level, entity_data);
+            performance_entity_tick_cycles[type] +=
+                performance_cycles() - start_cycles;
+        } else {
+            entity->tick(level, entity_data);
+        }
+        entity_tick_scale = 1;
 
         if(entity_data->should_remove) {
             if(entity->is_solid)
                 remove_solid_entity(xt0, yt0, entity_data, i);
 
             entity_data->type = -1;
+            release_entity_slot(i);
+
+            // entities added during the tick may have shifted this one
+            while(level_live_entities[index] != i)
+                index++;
+            remove_live_entity(index);
+            remove_cell_entity(i);
         } else {
             u32 xt1 = entity_data->x >> 4;
             u32 yt1 = entity_data->y >> 4;
 
+            const u32 cell = get_entity_cell(entity_data);
+            if(cell != entity_cell[i]) {
+                remove_cell_entity(i);
+                insert_cell_entity(cell, i);
+            }
+
             if(entity->is_solid && (xt1 != xt0 || yt1 != yt0)) {
                 remove_solid_entity(xt0, yt0, entity_data, i);
                 insert_solid_entity(xt1, yt1, entity_data, i);
             }
         }
+
+        // Entities added during the tick shift this entity to the right,
+        // while removing it shifts the next one to 'index': skip
+        // everything up to this entity's ID.
+        while(index < level_live_entity_count &&
+              level_live_entities[index] <= i)
+            index++;
     }
 }
 
 IWRAM_SECTION
 void level_tick(struct Level *level) {
+    const u32 start_cycles = performance_cycles();
+
+    // finish loading the level, if necessary
+    if(load_step < LOAD_STEPS)
+        while(!level_load_step());
+
     level_try_spawn(level, current_level);
 
+    const u32 tiles_cycles = performance_cycles();
     tick_tiles(level);
-    tick_entities(level);
-}
+    performance_tick_tiles_cycles += performance_cycles() - tiles_cycles;
 
-static inline void update_offset(struct Level *level) {
-    struct entity_Data *player = &level->entities[0];
-    if(player->type < ENTITY_TYPES) {
-        i32 x_offset = player->x - DISPLAY_WIDTH / 2;
-        i32 y_offset = player->y - DISPLAY_HEIGHT / 2 + 4;
-
-        if(x_offset < 16) x_offset = 16;
-        if(y_offset < 16) y_offset = 16;
+    tick_entities(level);
 
-        if(x_offset > LEVEL_W * 16 - DISPLAY_WIDTH - 16)
-            x_offset = LEVEL_W * 16 - DISPLAY_WIDTH - 16;
+    performance_level_tick_cycles = performance_cycles() - start_cycles;
+}
 
-        if(y_offset > LEVEL_H * 16 - DISPLAY_HEIGHT - 16)
-            y_offset = LEVEL_H * 16 - DISPLAY_HEIGHT - 16;
+static inline void redraw_tile(struct Level *level, u32 xt, u32 yt) {
+    u16 tiles[4] = { 0 };
+    draw_tile(level, xt, yt, tiles);
 
-        level_x_offset = x_offset;
-        level_y_offset = y_offset;
+    const u32 x = xt % TILEMAP_RING_SIZE;
+    const u32 y = yt % TILEMAP_RING_SIZE;
 
-        // level tiles offset
-        background_offset(
-            BG1,
-            level_x_offset & 0xf,
-            level_y_offset & 0xf
-        );
+    // each word holds two tilemap entries
+    u32 *tile_0 = &tilemap_buffer[x + y * 32];
+    *(tile_0)      = (tiles[1] << 16) | tiles[0];
+    *(tile_0 + 16) = (tiles[3] << 16) | tiles[2];
 
-        // light offset
-        background_offset(
-            BG2,
-            level_x_offset & 0xf,
-            level_y_offset & 0xf
-        );
+    tilemap_changed = true;
+}
 
-        // sky background offset
-        background_offset(
-            BG0,
-            (level_x_offset >> 2) & 0x7,
-            (level_y_offset >> 2) & 0x7
-        );
-    }
+static inline void redraw_area(struct Level *level, u32 x0, u32 y0,
+                               u32 x1, u32 y1) {
+    for(u32 yt = y0; yt < y1; yt++)
+        for(u32 xt = x0; xt < x1; xt++)
+            redraw_tile(level, xt, yt);
 }
 
 static inline void draw_tiles(struct Level *level) {
     const u32 x0 = level_x_offset >> 4;
     const u32 y0 = level_y_offset >> 4;
+    const u32 x1 = x0 + VISIBLE_TILES_W;
+    const u32 y1 = y0 + VISIBLE_TILES_H;
 
-    for(u32 t = 0; t < 16 * 10; t++) {
-        const u32 x = t % 16;
-        const u32 y = t / 16;
-
-        u16 tiles[4] = { 0 };
+    if(!tilemap_valid) {
+        redraw_area(level, x0, y0, x1, y1);
+    } else {
+        const u32 old_x0 = tilemap_x0;
+        const u32 old_y0 = tilemap_y0;
+        const u32 old_x1 = old_x0 + VISIBLE_TILES_W;
+        const u32 old_y1 = old_y0 + VISIBLE_TILES_H;
+
+        // draw the newly exposed columns, then the newly exposed rows
+        if(x0 > old_x0)
+            redraw_area(level, (x0 > old_x1 ? x0 : old_x1), y0, x1, y1);
+        else if(x0 < old_x0)
+            redraw_area(level, x0, y0, (x1 < old_x0 ? x1 : old_x0), y1);
+
+        if(y0 > old_y0)
+            redraw_area(level, x0, (y0 > old_y1 ? y0 : old_y1), x1, y1);
+        else if(y0 < old_y0)
+            redraw_area(level, x0, y0, x1, (y1 < old_y0 ? y1 : old_y0));
+
+        // draw the tiles that changed while visible
+        for(u32 i = 0; i < dirty_tile_count; i++) {
+            const u32 xt = dirty_tiles[i] % LEVEL_W;
+            const u32 yt = dirty_tiles[i] / LEVEL_W;
+
+            if(xt >= x0 && xt < x1 && yt >= y0 && yt < y1)
+                redraw_tile(level, xt, yt);
+        }
 
-        draw_tile(level, x0 + x, y0 + y, tiles);
+        // liquid tiles are animated: draw those whose animation changed
+        const u32 elapsed = tick_count - tilemap_tick;
+        for(u32 yt = y0; yt < y1; yt++) {
+            for(u32 xt = x0; xt < x1; xt++) {
+                if(level->tiles[xt + yt * LEVEL_W] != LIQUID_TILE)
+                    continue;
 
-        // using 32bit writes instead of 16bit writes saves a little time
-        vu32 *tile_0 = (vu32 *) &BG1_TILEMAP[x * 2 + y * 2 * 32];
-        *(tile_0)      = (tiles[1] << 16) | tiles[0];
-        *(tile_0 + 16) = (tiles[3] << 16) | tiles[2];
+                if(elapsed >= 10 || LIQUID_ANIMATION_TIME(xt, yt) % 10 < elapsed)
+                    redraw_tile(level, xt, yt);
+            }
+        }
     }
-}
-
-static inline void draw_lantern_light(struct entity_Data *data) {
-    i32 xr = ((data->x + 4) >> 3) - ((level_x_offset >> 3) & ~1);
-    i32 yr = ((data->y + 4) >> 3) - ((level_y_offset >> 3) & ~1);
-
-    i32 xl0 = xr - 7;
-    i32 yl0 = yr - 7;
-    i32 xl1 = xr + 7;
-    i32 yl1 = yr + 7;
 
-    if(xl1 < 0 || yl1 < 0)
-        return;
+    tilemap_valid = true;
+    tilemap_tick = tick_count;
+    tilemap_x0 = x0;
+    tilemap_y0 = y0;
+    dirty_tile_count = 0;
+}
 
-    if(xl0 < 0) xl0 = 0;
-    if(yl0 < 0) yl0 = 0;
-    if(xl1 > 32) xl1 = 32;
-    if(yl1 > 20) yl1 = 20;
+// Light of a lantern, centered between cells 7 and 8: it is 2 where the
+// squared distance is at most 46 and 1 where it is at most 66.
+#define LANTERN_LIGHT_SIZE (14)
+
+static const u8 lantern_light[LANTERN_LIGHT_SIZE * LANTERN_LIGHT_SIZE] = {
+    0, 0, 0, 1, 1, 1, 1, 1, 1, 1, 1, 0, 0, 0,
+    0, 0, 1, 1, 2, 2, 2, 2, 2, 2, 1, 1, 0, 0,
+    0, 1, 1, 2, 2, 2, 2, 2, 2, 2, 2, 1, 1, 0,
+    1, 1, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 1, 1,
+    1, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 1,
+    1, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 1,
+    1, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 1,
+    1, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 1,
+    1, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 1,
+    1, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 1,
+    1, 1, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 1, 1,
+    0, 1, 1, 2, 2, 2, 2, 2, 2, 2, 2, 1, 1, 0,
+    0, 0, 1, 1, 2, 2, 2, 2, 2, 2, 1, 1, 0, 0,
+    0, 0, 0, 1, 1, 1, 1, 1, 1, 1, 1, 0, 0, 0
+};
+
+static inline void stamp_lantern_light(struct entity_Data *data) {
+    const i32 xl0 = ((data->x + 4) >> 3) - ((level_x_offset >> 3) & ~1) -
+                    LANTERN_LIGHT_SIZE / 2;
+    const i32 yl0 = ((data->y + 4) >> 3) - ((level_y_offset >> 3) & ~1) -
+                    LANTERN_LIGHT_SIZE / 2;
+
+    // clip the light to the light layer
+    const i32 xm0 = (xl0 < 0) ? -xl0 : 0;
+    const i32 ym0 = (yl0 < 0) ? -yl0 : 0;
+    const i32 xm1 = (xl0 + LANTERN_LIGHT_SIZE > 32) ? 32 - xl0
+                                                    : LANTERN_LIGHT_SIZE;
+    const i32 ym1 = (yl0 + LANTERN_LIGHT_SIZE > 20) ? 20 - yl0
+                                                    : LANTERN_LIGHT_SIZE;
+
+    for(i32 ym = ym0; ym < ym1; ym++) {
+        const u8 *mask_row = &lantern_light[ym * LANTERN_LIGHT_SIZE];
+        u16 *light_row = (u16 *) light_buffer + xl0 + (yl0 + ym) * 32;
+
+        for(i32 xm = xm0; xm < xm1; xm++) {
+            const u16 val = 192 + mask_row[xm];
+            if(light_row[xm] < val)
+                light_row[xm] = val;
+        }
+    }
+}
 
-    for(i32 yl = yl0; yl < yl1; yl++) {
-        u32 yd = (yl - yr + (yl >= yr)) * (yl - yr + (yl >= yr));
+// Returns true if the light of a lantern reaches the light layer
+static inline bool is_lantern_light_visible(struct entity_Data *data) {
+    const i32 xl0 = ((data->x + 4) >> 3) - ((level_x_offset >> 3) & ~1) -
+                    LANTERN_LIGHT_SIZE / 2;
+    const i32 yl0 = ((data->y + 4) >> 3) - ((level_y_offset >> 3) & ~1) -
+                    LANTERN_LIGHT_SIZE / 2;
 
-        for(i32 xl = xl0; xl < xl1; xl++) {
-            u32 xd = (xl - xr + (xl >= xr)) * (xl - xr + (xl >= xr));
+    return xl0 + LANTERN_LIGHT_SIZE > 0 && xl0 < 32 &&
+           yl0 + LANTERN_LIGHT_SIZE > 0 && yl0 < 20;
+}
 
-            u32 val = 192 + (xd + yd <= 66) + (xd + yd <= 46);
-            if(BG2_TILEMAP[xl + yl * 32] < val)
-                BG2_TILEMAP[xl + yl * 32] = val;
-        }
-    }
+static inline u32 player_light_sprites(void) {
+    return (player_active_item.type == LANTERN_ITEM) ? 4 : 1;
 }
 
+// The sprites of the light are reserved when budgeting the entities, so
+// they always fit.
 static inline void draw_player_light(struct Level *level, u32 *used_sprites) {
     struct entity_Data *player = &level->entities[0];
 
@@ -214,16 +809,12 @@ static inline void draw_player_light(struct Level *level, u32 *used_sprites) {
     const u32 y = player->y - 3 - level_y_offset;
 
     if(player_active_item.type == LANTERN_ITEM) {
-        // overwrite the last 4 sprites if necessary
-        if(*used_sprites > 128 - 4)
-            *used_sprites = 128 - 4;
-
         // draw four 64x64 sprites
         for(u32 i = 0; i < 4; i++) {
             const u32 xi = i % 2;
             const u32 yi = i / 2;
 
-            sprite_config(*used_sprites + i, &(struct Sprite) {
+            screen_sprite_config(*used_sprites + i, &(struct Sprite) {
                 .x = (x - 64) + xi * 64,
                 .y = (y - 64) + yi * 64,
 
@@ -236,12 +827,8 @@ static inline void draw_player_light(struct Level *level, u32 *used_sprites) {
         }
         *used_sprites += 4;
     } else {
-        // overwrite the last sprite if necessary
-        if(*used_sprites > 128 - 1)
-            *used_sprites = 128 - 1;
-
         // draw a single 32x32 sprite
-        sprite_config(*used_sprites, &(struct Sprite) {
+        screen_sprite_config(*used_sprites, &(struct Sprite) {
             .x = x - 16,
             .y = y - 16,
 
@@ -260,41 +847,74 @@ static inline void draw_player_light(struct Level *level, u32 *used_sprites) {
 static inline void draw_entities(struct Level *level) {
     u8 *entities_to_render = entities_render_buffer;
 
+    // lanterns outside of the screen can still light it up
+    const u32 margin = (level < &levels[3]) ? 64 : 16;
+
+    u8 *nearby_entities = entities_query_buffer;
+    const u32 nearby_count = level_find_entities(
+        (i32) level_x_offset - margin,
+        (i32) level_y_offset - margin,
+        (i32) level_x_offset + DISPLAY_WIDTH  + margin,
+        (i32) level_y_offset + DISPLAY_HEIGHT + margin,
+        nearby_entities
+    );
+
+    u32 lit_lantern_count = 0;
+
     u32 to_render_size = 0;
-    for(u32 i = 0; i < ENTITY_LIMIT; i++) {
+    for(u32 n = 0; n < nearby_count; n++) {
+        const u8 i = nearby_entities[n];
         struct entity_Data *data = &level->entities[i];
-        if(data->type >= ENTITY_TYPES)
-            continue;
 
         // position relative to top-left of the screen
         i32 xr = data->x - level_x_offset;
         i32 yr = data->y - level_y_offset;
 
-        // draw lantern light
+        // lanterns are lit after all of them are collected
         if(level < &levels[3] && data->type == LANTERN_ENTITY)
-            draw_lantern_light(data);
+            if(is_lantern_light_visible(data))
+                lit_lanterns[lit_lantern_count++] = i;
 
         if(xr < -16 || xr >= DISPLAY_WIDTH + 16 ||
            yr < -16 || yr >= DISPLAY_HEIGHT)
             continue;
 
         entities_to_render[to_render_size++] = i;
-        if(to_render_size == 128)
-            break;
     }
 
+    for(u32 i = 0; i < lit_lantern_count; i++)
+        stamp_lantern_light(&level->entities[lit_lanterns[i]]);
+
+    // the player light sprites are reserved
+    const u32 sprite_budget = SPRITE_COUNT - (
+        (level < &levels[3]) ? player_light_sprites() : 0
+    );
+    to_render_size = budget_sprites(
+        level, entities_to_render, to_render_size, sprite_budget
+    );
+
+    const u32 sort_cycles = performance_cycles();
     entities_to_render = sort_entities(
         level, entities_to_render, to_render_size
     );
+    performance_sort_cycles += performance_cycles() - sort_cycles;
 
     u32 used_sprites = 0;
-    for(u32 i = 0; i < to_render_size && used_sprites < 128; i++) {
+    for(u32 i = 0; i < to_render_size && used_sprites < sprite_budget; i++) {
         struct entity_Data *data = &level->entities[
             entities_to_render[to_render_size - i - 1]
         ];
 
         const struct Entity *entity = ENTITY_S(data);
-        used_sprites += entity->draw(level, data, used_sprites);
+
+        if(performance_entity_timing) {
+            const u32 start_cycles = performance_cycles();
+            used_sprites += entity->draw(level, data, used_sprites);
+            performance_entity_draw_cycles[data->type] +=
+                performance_cycles() - start_cycles;
+        } else {
+            used_sprites += entity->draw(level, data, used_sprites);
+        }
     }
 
     // draw player light
@@ -302,91 +922,88 @@ static inline void draw_entities(struct Level *level) {
         draw_player_light(level, &used_sprites);
 
     // hide remaining sprites
-    sprite_hide_range(used_sprites, SPRITE_COUNT);
+    screen_sprite_hide_range(used_sprites, SPRITE_COUNT);
 }
 
 static inline void clear_light(void) {
-    for(u32 i = 0; i < 32 * 20; i++)
-        BG2_TILEMAP[i] = 192;
+    for(u32 i = 0; i < 32 * 20 / 2; i++)
+        light_buffer[i] = 192 | 192 << 16;
 }
 
-static inline void draw_lava_light(struct Level *level) {
-    const u32 x0 = level_x_offset >> 4;
-    const u32 y0 = level_y_offset >> 4;
-
-    for(i32 y = -2; y < 10 + 2; y++) {
-        for(i32 x = -2; x < 16 + 2; x++) {
-            if(LEVEL_GET_TILE(level, x0 + x, y0 + y) != LIQUID_TILE)
-                continue;
-
-            if((x0 + x) & 1 &&
-               LEVEL_GET_TILE(level, x0 + x - 1, y0 + y) == LIQUID_TILE &&
-               LEVEL_GET_TILE(level, x0 + x + 1, y0 + y) == LIQUID_TILE)
-                continue;
-
-            if((y0 + y) & 1 &&
-               LEVEL_GET_TILE(level, x0 + x, y0 + y - 1) == LIQUID_TILE &&
-               LEVEL_GET_TILE(level, x0 + x, y0 + y + 1) == LIQUID_TILE)
-                continue;
-
-            i32 xr = x * 2 + 1;
-            i32 yr = y * 2 + 1;
+IWRAM_SECTION
+void level_draw(struct Level *level) {
+    update_offset(level);
 
-            i32 xl0 = xr - 5;
-            i32 yl0 = yr - 5;
-            i32 xl1 = xr + 5;
-            i32 yl1 = yr + 5;
+    // while loading, wait until the visible rows are ready
+    if(load_step < LOAD_STEPS && !are_visible_rows_loaded())
+        return;
 
-            if(xl0 < 0) xl0 = 0;
-            if(yl0 < 0) yl0 = 0;
-            if(xl1 > 32) xl1 = 32;
-            if(yl1 > 20) yl1 = 20;
+    // the lava light replaces the cleared light layer: lanterns are
+    // then drawn on top of it
+    if(level == &levels[0]) {
+        const u32 lava_cycles = performance_cycles();
+        draw_lava_light(light_buffer);
+        performance_lava_light_cycles += performance_cycles() - lava_cycles;
+    } else if(level < &levels[3]) {
+        clear_light();
+    }
 
-            for(i32 yl = yl0; yl < yl1; yl++) {
-                u32 yd = (yl - yr + (yl >= yr)) * (yl - yr + (yl >= yr));
+    const u32 tiles_cycles = performance_cycles();
+    draw_tiles(level);
+    performance_draw_tiles_cycles += performance_cycles() - tiles_cycles;
 
-                for(i32 xl = xl0; xl < xl1; xl++) {
-                    u32 xd = (xl - xr + (xl >= xr)) * (xl - xr + (xl >= xr));
+    draw_entities(level);
 
-                    u32 val = 192 + (xd + yd <= 34) + (xd + yd <= 24);
-                    if(BG2_TILEMAP[xl + yl * 32] < val)
-                        BG2_TILEMAP[xl + yl * 32] = val;
-                }
-            }
-        }
+    if(tilemap_changed) {
+        screen_queue_upload(
+            BG1_TILEMAP, tilemap_buffer, sizeof(tilemap_buffer)
+        );
+        tilemap_changed = false;
     }
+    if(level < &levels[3])
+        screen_queue_upload(BG2_TILEMAP, light_buffer, sizeof(light_buffer));
+
+    screen_queue_upload(BG_OFFSETS, bg_offsets, sizeof(bg_offsets));
 }
 
-IWRAM_SECTION
-void level_draw(struct Level *level) {
-    update_offset(level);
+static inline u8 find_free_slot(struct Level *level) {
+    // The slot bitmap only describes the loaded level. Other levels
+    // (e.g. while generating the world) are scanned linearly.
+    if(level != loaded_level) {
+        for(u32 i = 1; i < ENTITY_LIMIT; i++)
+            if(level->entities[i].type >= ENTITY_TYPES)
+                return i;
+        return -1;
+    }
 
-    if(level < &levels[3])
-        clear_light();
+    // take the lowest free slot, as the linear scan would
+    for(u32 w = 0; w < ENTITY_BITMAP_WORDS; w++) {
+        const u32 bits = free_entity_slots[w];
+        if(bits == 0)
+            continue;
 
-    draw_tiles(level);
-    draw_entities(level);
+        const u32 bit = lowest_set_bit(bits);
+        free_entity_slots[w] = bits & ~(1u << bit);
 
-    if(level == &levels[0])
-        draw_lava_light(level);
+        return w * 32 + bit;
+    }
+    return -1;
 }
 
 IWRAM_SECTION
 u8 level_new_entity(struct Level *level, u8 type) {
-    for(u32 i = 1; i < ENTITY_LIMIT; i++) {
-        struct entity_Data *data = &level->entities[i];
+    const u8 entity_id = find_free_slot(level);
+    if(entity_id >= ENTITY_LIMIT)
+        return -1;
 
-        if(data->type >= ENTITY_TYPES) {
-            data->type = type;
+    struct entity_Data *data = &level->entities[entity_id];
+    data->type = type;
 
-            // clear entity data
-            for(u32 b = 0; b < sizeof(data->data); b++)
-                data->data[b] = 0;
+    // clear entity data
+    for(u32 b = 0; b < sizeof(data->data); b++)
+        data->data[b] = 0;
 
-            return i;
-        }
-    }
-    return -1;
+    return entity_id;
 }
 
 IWRAM_SECTION
@@ -396,6 +1013,13 @@ void level_add_entity(struct Level *level, u8 entity_id) {
 
     data->should_remove = false;
 
+    // entities of levels that are not loaded are indexed by 'level_load'
+    if(level != loaded_level)
+        return;
+
+    insert_live_entity(entity_id);
+    insert_cell_entity(get_entity_cell(data), entity_id);
+
     if(entity->is_solid) {
         u32 xt = data->x >> 4;
         u32 yt = data->y >> 4;
@@ -433,10 +1057,13 @@ void level_try_spawn(struct Level *level, u8 level_index) {
     i32 x1 = x + r;
     i32 y1 = y + r;
 
-    for(u32 i = 0; i < ENTITY_LIMIT; i++) {
-        struct entity_Data *e_data = &level->entities[i];
-        if(e_data->type >= ENTITY_TYPES)
-            continue;
+    u8 nearby_entities[ENTITY_LIMIT];
+    const u32 nearby_count = level_find_entities(
+        x0, y0, x1, y1, nearby_entities
+    );
+
+    for(u32 i = 0; i < nearby_count; i++) {
+        struct entity_Data *e_data = &level->entities[nearby_entities[i]];
 
         if(entity_intersects(e_data, x0, y0, x1, y1))
             return;
@@ -455,3 +1082,44 @@ void level_try_spawn(struct Level *level, u8 level_index) {
     else
         entity_add_zombie(level, x, y, entity_level);
 }
+
+IWRAM_SECTION
+u32 level_find_entities(i32 x0, i32 y0, i32 x1, i32 y1, u8 *result) {
+    x0 -= CELL_QUERY_MARGIN;
+    y0 -= CELL_QUERY_MARGIN;
+    x1 += CELL_QUERY_MARGIN;
+    y1 += CELL_QUERY_MARGIN;
+
+    if(x1 < 0 || y1 < 0)
+        return 0;
+
+    i32 xc0 = (x0 < 0 ? 0 : x0) / (LEVEL_CELL_SIZE * 16);
+    i32 yc0 = (y0 < 0 ? 0 : y0) / (LEVEL_CELL_SIZE * 16);
+    i32 xc1 = x1 / (LEVEL_CELL_SIZE * 16);
+    i32 yc1 = y1 / (LEVEL_CELL_SIZE * 16);
+
+    if(xc1 >= LEVEL_CELLS_W) xc1 = LEVEL_CELLS_W - 1;
+    if(yc1 >= LEVEL_CELLS_H) yc1 = LEVEL_CELLS_H - 1;
+
+    // mark the entities in a bitmap, so that they are sorted by ID
+    u32 found[ENTITY_BITMAP_WORDS] = { 0 };
+    for(i32 yc = yc0; yc <= yc1; yc++) {
+        for(i32 xc = xc0; xc <= xc1; xc++) {
+            u8 id = cell_first_entity[xc + yc * LEVEL_CELLS_W];
+            while(id < ENTITY_LIMIT) {
+                found[id / 32] |= 1u << (id % 32);
+                id = cell_next_entity[id];
+            }
+        }
+    }
+
+    u32 count = 0;
+    for(u32 w = 0; w < ENTITY_BITMAP_WORDS; w++) {
+        u32 bits = found[w];
+        while(bits != 0) {
+            result[count++] = w * 32 + lowest_set_bit(bits);
+            bits &= bits - 1;
+        }
+    }
+    return count;
+}
@@ -18,6 +18,7 @@
 #include "screen.h"
 #include "scene.h"
 #include "performance.h"
+#include "replay.h"
 
 u32 tick_count = 0;
 u32 expected_tickcount = 0;
@@ -30,6 +31,7 @@ u8 current_level;
 static inline void tick(void) {
     audio_update();
     input_update();
+    replay_update();
     scene->tick();
 
     performance_tick();
@@ -39,12 +41,16 @@ static inline void tick(void) {
 
 static inline void draw(void) {
     scene->draw();
-
     performance_draw();
+
+    screen_commit_sprites();
+    screen_commit_bg3();
 }
 
 IWRAM_SECTION
 static void vblank(void) {
+    screen_vblank();
+
     expected_tickcount++;
     performance_vblank();
 }
@@ -58,6 +64,7 @@ void AgbMain(void) {
     audio_init(AUDIO_BASIC);
     input_init(30, 2);
     screen_init();
+    performance_init();
 
     set_scene(&scene_prestart, 0);
 
@@ -55,13 +55,21 @@ void mob_tick(struct Level *level, struct entity_Data *data) {
     if(mob_data->hp <= 0)
         mob_die(level, data);
 
-    if(mob_data->hurt_time > 0)
-        mob_data->hurt_time--;
+    if(mob_data->hurt_time > entity_tick_scale)
+        mob_data->hurt_time -= entity_tick_scale;
+    else
+        mob_data->hurt_time = 0;
 }
 
 IWRAM_SECTION
 bool mob_move(struct Level *level, struct entity_Data *data,
               i32 xm, i32 ym) {
+    return mob_move_steps(level, data, xm, ym, entity_tick_scale);
+}
+
+IWRAM_SECTION
+bool mob_move_steps(struct Level *level, struct entity_Data *data,
+                    i32 xm, i32 ym, u32 steps) {
     struct mob_Data *mob_data = (struct mob_Data *) &data->data;
 
     if(mob_data->knockback.val > 0) {
@@ -69,8 +77,16 @@ bool mob_move(struct Level *level, struct entity_Data *data,
         i32 xk = (dir == 3) - (dir == 1);
         i32 yk = (dir == 2) - (dir == 0);
 
-        entity_move2(level, data, xk, yk);
-        mob_data->knockback.val--;
+        // far mobs tick less often: apply the knockback of all the
+        // skipped ticks, but not more than what is left
+        u32 knockback_steps = entity_tick_scale;
+        if(knockback_steps > mob_data->knockback.val)
+            knockback_steps = mob_data->knockback.val;
+
+        // one pixel at a time, as when ticking every tick
+        for(u32 i = 0; i < knockback_steps; i++)
+            entity_move2(level, data, xk, yk);
+        mob_data->knockback.val -= knockback_steps;
     }
 
     if(mob_data->hurt_time > 0)
@@ -80,10 +96,15 @@ bool mob_move(struct Level *level, struct entity_Data *data,
         mob_data->dir = (ym == 0) * ((xm < 0) * 1 + (xm > 0) * 3) +
                                     ((ym < 0) * 0 + (ym > 0) * 2);
 
-        mob_data->walk_dist++;
+        mob_data->walk_dist += steps;
     }
 
-    return entity_move(level, data, xm, ym);
+    // one pixel at a time, so that walls stop the mob where they would
+    // when ticking every tick
+    for(u32 i = 0; i < steps; i++)
+        if(!entity_move(level, data, xm, ym))
+            return false;
+    return true;
 }
 
 IWRAM_SECTION
@@ -16,46 +16,167 @@
 #include "performance.h"
 
 #include "level.h"
-#include "entity.h"
 #include "screen.h"
+#include "replay.h"
 
 #define OAM ((vu16 *) 0x07000000)
 
-static bool show_performance = false;
+// timers 2 and 3 are cascaded to make a 32-bit cycle counter
+#define TIMER2_COUNTER ((vu16 *) 0x04000108)
+#define TIMER2_CONTROL ((vu16 *) 0x0400010a)
+#define TIMER3_COUNTER ((vu16 *) 0x0400010c)
+#define TIMER3_CONTROL ((vu16 *) 0x0400010e)
+
+// overlay pages: overview, tick cycles, draw cycles
+#define PAGE_HIDDEN (0)
+#define PAGE_COUNT  (3)
+
+static u8 overlay_page = PAGE_HIDDEN;
 static u16 tick_vcount;
 static u16 draw_vcount;
 
 static u16 ticks = 0, frames = 0;
 static u16 tps   = 0, fps    = 0;
 
+// ticks and frames since the counters were last reset
+static u16 sampled_ticks = 0, sampled_frames = 0;
+
+u32 performance_level_tick_cycles = 0;
+
+u32 performance_entity_tick_cycles[ENTITY_TYPES];
+u32 performance_entity_draw_cycles[ENTITY_TYPES];
+
+u32 performance_tick_tiles_cycles = 0;
+u32 performance_draw_tiles_cycles = 0;
+u32 performance_lava_light_cycles = 0;
+u32 performance_sort_cycles = 0;
+
+bool performance_entity_timing = false;
+
+static const char * const entity_names[ENTITY_TYPES] = {
+    "ZOMB", "SLIM", "WIZD", "PLYR",
+    "WBEN", "FURN", "OVEN", "ANVL", "CHST", "LANT",
+    "ITEM", "SPRK",
+    "TEXT", "SMSH"
+};
+
+void performance_init(void) {
+    *TIMER2_CONTROL = 0;
+    *TIMER3_CONTROL = 0;
+    *TIMER2_COUNTER = 0;
+    *TIMER3_COUNTER = 0;
+
+    // timer 3: enable, count up when timer 2 overflows
+    *TIMER3_CONTROL = 1 << 7 | 1 << 2;
+
+    // timer 2: enable, prescaler = 1 cycle
+    *TIMER2_CONTROL = 1 << 7;
+}
+
+IWRAM_SECTION
+u32 performance_cycles(void) {
+    u16 high, low;
+
+    // if timer 2 overflows between the two reads, read again
+    do {
+        high = *TIMER3_COUNTER;
+        low  = *TIMER2_COUNTER;
+    } while(high != *TIMER3_COUNTER);
+
+    return (u32) high << 16 | low;
+}
+
+static inline void clear_overlay(void) {
+    for(u32 y = 0; y < 18; y++)
+        for(u32 x = 0; x < 12; x++)
+            BG3_TILEMAP[x + y * 32] = 0;
+
+    for(u32 y = 0; y < 2; y++)
+        for(u32 x = 28; x < 30; x++)
+            BG3_TILEMAP[x + y * 32] = 0;
+}
+
 void performance_tick(void) {
     tick_vcount = display_vcount();
     ticks++;
+    sampled_ticks++;
 
+    // cycle through the pages, then hide the overlay
     if(input_down(KEY_L) && input_down(KEY_R) &&
        input_press(KEY_SELECT)) {
-        show_performance = !show_performance;
+        overlay_page = (overlay_page + 1) % (PAGE_COUNT + 1);
+        clear_overlay();
+
+        performance_entity_timing = (overlay_page == 2 || overlay_page == 3);
     }
 }
 
-void performance_draw(void) {
-    draw_vcount = display_vcount();
-    frames++;
+static inline void reset_counters(void) {
+    for(u32 i = 0; i < ENTITY_TYPES; i++) {
+        performance_entity_tick_cycles[i] = 0;
+        performance_entity_draw_cycles[i] = 0;
+    }
 
-    if(!show_performance || tick_count % 15 != 0)
-        return;
+    performance_tick_tiles_cycles = 0;
+    performance_draw_tiles_cycles = 0;
+    performance_lava_light_cycles = 0;
+    performance_sort_cycles = 0;
 
+    sampled_ticks = 0;
+    sampled_frames = 0;
+}
+
+static inline void write_cycles(const char *name, u32 cycles, u32 samples,
+                                u32 y) {
+    screen_write(name, 0, 0, y);
+    SCREEN_WRITE_NUMBER(cycles / samples, 10, 6, false, 0, 5, y);
+}
+
+static inline void draw_tick_page(void) {
+    const u32 samples = sampled_ticks ? sampled_ticks : 1;
+
+    for(u32 i = 0; i < ENTITY_TYPES; i++) {
+        write_cycles(
+            entity_names[i], performance_entity_tick_cycles[i], samples, i
+        );
+    }
+
+    write_cycles("TILE", performance_tick_tiles_cycles, samples, 15);
+}
+
+static inline void draw_draw_page(void) {
+    const u32 samples = sampled_frames ? sampled_frames : 1;
+
+    for(u32 i = 0; i < ENTITY_TYPES; i++) {
+        write_cycles(
+            entity_names[i], performance_entity_draw_cycles[i], samples, i
+        );
+    }
+
+    write_cycles("TILE", performance_draw_tiles_cycles, samples, 15);
+    write_cycles("LAVA", performance_lava_light_cycles, samples, 16);
+    write_cycles("SORT", performance_sort_cycles,       samples, 17);
+}
+
+static inline void draw_overview_page(void) {
     SCREEN_WRITE_NUMBER(tick_vcount, 16, 2, true, 0, 0, 0);
     SCREEN_WRITE_NUMBER(draw_vcount, 16, 2, true, 0, 0, 1);
 
     SCREEN_WRITE_NUMBER(tps, 10, 2, true, 0, 0, 3);
     SCREEN_WRITE_NUMBER(fps, 10, 2, true, 0, 0, 4);
 
-    // count entities
-    u32 entity_count = 0;
-    for(u32 i = 0; i < ENTITY_LIMIT; i++)
-        if(levels[current_level].entities[i].type < ENTITY_TYPES)
-            entity_count++;
+    SCREEN_WRITE_NUMBER(performance_level_tick_cycles, 16, 6, true, 0, 0, 6);
+
+    if(replay_mode == REPLAY_RECORDING) {
+        screen_write("REC", 0, 0, 8);
+    } else if(replay_mode == REPLAY_PLAYING) {
+        screen_write("RPL", 0, 0, 8);
+    } else {
+        for(u32 x = 0; x < 3; x++)
+            BG3_TILEMAP[x + 8 * 32] = 0;
+    }
+
+    u32 entity_count = level_live_entity_count;
 
     // count sprites
     u32 sprite_count = 0;
@@ -67,6 +188,28 @@ void performance_draw(void) {
     SCREEN_WRITE_NUMBER(sprite_count, 16, 2, true, 0, 28, 1);
 }
 
+void performance_draw(void) {
+    draw_vcount = display_vcount();
+    frames++;
+    sampled_frames++;
+
+    if(tick_count % 15 != 0)
+        return;
+
+    switch(overlay_page) {
+        case 1:
+            draw_overview_page();
+            break;
+        case 2:
+            draw_tick_page();
+            break;
+        case 3:
+            draw_draw_page();
+            break;
+    }
+    reset_counters();
+}
+
 IWRAM_SECTION
 void performance_vblank(void) {
     static u32 vblanks = 0;
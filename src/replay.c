@@ -0,0 +1,197 @@
+/* Copyright 2023 Vulcalien
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+#include "replay.h"
+
+#include "options.h"
+
+#define KEY_COUNT (10)
+
+// same values passed to 'input_init'
+#define REPEAT_DELAY    (30)
+#define REPEAT_INTERVAL (2)
+
+#define RUN_MAX (1 << (16 - REPLAY_RUN_SHIFT))
+
+u8 replay_mode = REPLAY_OFF;
+
+u32 replay_seed;
+bool replay_keep_inventory;
+
+SBSS_SECTION
+u16 replay_stream[REPLAY_STREAM_SIZE];
+u32 replay_length = 0;
+
+static u32 stream_index;
+static u32 stream_run;
+
+static u16 keys;
+static u16 previous_keys;
+static u16 repeated_keys;
+
+static u16 hold_time[KEY_COUNT];
+
+static void reset_keys(void) {
+    // keys held when the replay starts are not considered pressed
+    keys = REPLAY_KEYS_MASK;
+    previous_keys = REPLAY_KEYS_MASK;
+    repeated_keys = 0;
+
+    for(u32 i = 0; i < KEY_COUNT; i++)
+        hold_time[i] = 0;
+}
+
+THUMB
+void replay_record(void) {
+    replay_seed = random_seed(0);
+    random_seed(replay_seed);
+
+    replay_keep_inventory = options.keep_inventory;
+
+    replay_length = 0;
+    reset_keys();
+
+    replay_mode = REPLAY_RECORDING;
+}
+
+THUMB
+bool replay_play(void) {
+    if(replay_length == 0)
+        return false;
+
+    random_seed(replay_seed);
+    options.keep_inventory = replay_keep_inventory;
+
+    stream_index = 0;
+    stream_run = 0;
+    reset_keys();
+
+    replay_mode = REPLAY_PLAYING;
+    return true;
+}
+
+static inline u16 read_keys(void) {
+    u16 result = 0;
+    for(u32 i = 0; i < KEY_COUNT; i++)
+        if(input_down(1 << i))
+            result |= 1 << i;
+    return result;
+}
+
+static inline void record_keys(u16 state) {
+    if(replay_length > 0) {
+        u16 *last = &replay_stream[replay_length - 1];
+
+        if((*last & REPLAY_KEYS_MASK) == state &&
+           (*last >> REPLAY_RUN_SHIFT) < RUN_MAX - 1) {
+            *last += 1 << REPLAY_RUN_SHIFT;
+            return;
+        }
+    }
+
+    // if the stream is full, stop recording
+    if(replay_length == REPLAY_STREAM_SIZE) {
+        replay_mode = REPLAY_OFF;
+        return;
+    }
+    replay_stream[replay_length++] = state;
+}
+
+static inline bool play_keys(void) {
+    if(stream_index == replay_length)
+        return false;
+
+    const u16 entry = replay_stream[stream_index];
+    keys = entry & REPLAY_KEYS_MASK;
+
+    stream_run++;
+    if(stream_run > (entry >> REPLAY_RUN_SHIFT)) {
+        stream_index++;
+        stream_run = 0;
+    }
+    return true;
+}
+
+// pressing SELECT stops playing the replay (L + R + SELECT is left to
+// the performance overlay)
+static inline bool abort_pressed(void) {
+    return input_press(KEY_SELECT) &&
+           !(input_down(KEY_L) && input_down(KEY_R));
+}
+
+IWRAM_SECTION
+void replay_update(void) {
+    if(replay_mode == REPLAY_OFF)
+        return;
+
+    previous_keys = keys;
+
+    if(replay_mode == REPLAY_RECORDING) {
+        keys = read_keys();
+        record_keys(keys);
+    } else if(!play_keys() || abort_pressed()) {
+        // the replay is over: give control back to the player
+        replay_mode = REPLAY_OFF;
+        return;
+    }
+
+    // a key repeats when pressed, then every REPEAT_INTERVAL ticks after
+    // being held for REPEAT_DELAY ticks
+    repeated_keys = 0;
+    for(u32 i = 0; i < KEY_COUNT; i++) {
+        if((keys & (1 << i)) == 0) {
+            hold_time[i] = 0;
+            continue;
+        }
+
+        if((previous_keys & (1 << i)) == 0) {
+            hold_time[i] = 0;
+            repeated_keys |= 1 << i;
+        } else {
+            hold_time[i]++;
+            if(hold_time[i] >= REPEAT_DELAY &&
+               (hold_time[i] - REPEAT_DELAY) % REPEAT_INTERVAL == 0)
+                repeated_keys |= 1 << i;
+        }
+    }
+}
+
+IWRAM_SECTION
+bool game_input_down(u16 key) {
+    if(replay_mode == REPLAY_OFF)
+        return input_down(key);
+    return (keys & key) != 0;
+}
+
+IWRAM_SECTION
+bool game_input_press(u16 key) {
+    if(replay_mode == REPLAY_OFF)
+        return input_press(key);
+    return (keys & ~previous_keys & key) != 0;
+}
+
+IWRAM_SECTION
+bool game_input_release(u16 key) {
+    if(replay_mode == REPLAY_OFF)
+        return input_release(key);
+    return (~keys & previous_keys & key) != 0;
+}
+
+IWRAM_SECTION
+bool game_input_repeat(u16 key) {
+    if(replay_mode == REPLAY_OFF)
+        return input_repeat(key);
+    return (repeated_keys & key) != 0;
+}
@@ -16,10 +16,11 @@
 #include "scene.h"
 
 #include "screen.h"
+#include "replay.h"
 
 THUMB
 static void about_tick(void) {
-    if(input_press(KEY_B) || input_press(KEY_START))
+    if(game_input_press(KEY_B) || game_input_press(KEY_START))
         set_scene(&scene_start, 0);
 }
 
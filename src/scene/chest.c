@@ -20,6 +20,7 @@
 #include "item.h"
 #include "player.h"
 #include "furniture.h"
+#include "replay.h"
 
 static i32 selected[2] = { 0, 0 };
 static u8 chest_window;
@@ -40,12 +41,12 @@ THUMB
 static void chest_tick(void) {
     gametime++;
 
-    if(input_press(KEY_B) || input_press(KEY_START))
+    if(game_input_press(KEY_B) || game_input_press(KEY_START))
         set_scene(&scene_game, 1);
 
-    if(input_repeat(KEY_LEFT))
+    if(game_input_repeat(KEY_LEFT))
         chest_window = 0;
-    if(input_repeat(KEY_RIGHT))
+    if(game_input_repeat(KEY_RIGHT))
         chest_window = 1;
 
     struct Inventory *inv[2];
@@ -55,9 +56,9 @@ static void chest_tick(void) {
     if(inv[0]->size == 0)
         return;
 
-    if(input_repeat(KEY_UP))
+    if(game_input_repeat(KEY_UP))
         selected[chest_window]--;
-    if(input_repeat(KEY_DOWN))
+    if(game_input_repeat(KEY_DOWN))
         selected[chest_window]++;
 
     if(selected[chest_window] < 0)
@@ -65,7 +66,7 @@ static void chest_tick(void) {
     if(selected[chest_window] >= inv[0]->size)
         selected[chest_window] = 0;
 
-    if(input_repeat(KEY_A)) {
+    if(game_input_repeat(KEY_A)) {
         struct item_Data removed;
         inventory_remove(inv[0], &removed, selected[chest_window]);
 
@@ -21,6 +21,7 @@
 #include "crafting.h"
 #include "player.h"
 #include "sound.h"
+#include "replay.h"
 
 static i32 selected;
 
@@ -99,12 +100,12 @@ THUMB
 static void crafting_tick(void) {
     gametime++;
 
-    if(input_press(KEY_B) || input_press(KEY_START))
+    if(game_input_press(KEY_B) || game_input_press(KEY_START))
         set_scene(&scene_game, 1);
 
-    if(input_repeat(KEY_UP))
+    if(game_input_repeat(KEY_UP))
         selected--;
-    if(input_repeat(KEY_DOWN))
+    if(game_input_repeat(KEY_DOWN))
         selected++;
 
     if(selected < 0)
@@ -112,7 +113,7 @@ static void crafting_tick(void) {
     if(selected >= crafting_current_recipes_size)
         selected = 0;
 
-    if(input_repeat(KEY_A)) {
+    if(game_input_repeat(KEY_A)) {
         u8 recipe_id = sorted_recipes[selected];
 
         if(can_craft[recipe_id]) {
@@ -21,6 +21,7 @@
 #include "entity.h"
 #include "tile.h"
 #include "sound.h"
+#include "replay.h"
 
 static u8 death_time;
 
@@ -93,7 +94,7 @@ THUMB
 static void death_tick(void) {
     death_time++;
     if(death_time > 60) {
-        if(input_press(KEY_A) || input_press(KEY_B)) {
+        if(game_input_press(KEY_A) || game_input_press(KEY_B)) {
             SOUND_PLAY(sound_start);
             respawn();
             set_scene(&scene_game, 7);
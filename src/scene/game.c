@@ -46,10 +46,16 @@ static void game_init(u8 flags) {
         if(old_level && !(flags & 4))
             game_move_player(old_level, level);
 
-        level_load(level);
-
-        interrupt_wait(IRQ_VBLANK);
-        screen_update_level_specific();
+        // with flag 8, the caller completes the loading of the level and
+        // updates the palette (see scene/transition.c)
+        if(flags & 8) {
+            level_load_begin(level);
+        } else {
+            level_load(level);
+
+            interrupt_wait(IRQ_VBLANK);
+            screen_update_level_specific();
+        }
     }
 
     should_clear = true;
@@ -87,6 +93,9 @@ static inline void clear_screen(void) {
             BG3_TILEMAP[x + y * 32] = 32;
 
     should_clear = false;
+
+    // the status bar has been cleared
+    screen_invalidate_widgets();
 }
 
 static inline u16 get_player_hp(void) {
@@ -99,13 +108,22 @@ static inline u16 get_player_hp(void) {
     return 0;
 }
 
+static struct screen_Widget hp_widget;
+static struct screen_Widget stamina_widget;
+static struct screen_Widget stamina_color_widget;
+static struct screen_Widget active_item_widget;
+
 static inline void draw_status_bar(void) {
     u16 player_hp = get_player_hp();
 
     // draw hp and stamina
-    for(u32 i = 0; i < 10; i++) {
-        BG3_TILEMAP[i + 18 * 32] = (100 + (player_hp <= i))      | 10 << 12;
-        BG3_TILEMAP[i + 19 * 32] = (102 + (player_stamina <= i)) | 10 << 12;
+    if(screen_widget_changed(&hp_widget, player_hp)) {
+        for(u32 i = 0; i < 10; i++)
+            BG3_TILEMAP[i + 18 * 32] = (100 + (player_hp <= i)) | 10 << 12;
+    }
+    if(screen_widget_changed(&stamina_widget, player_stamina)) {
+        for(u32 i = 0; i < 10; i++)
+            BG3_TILEMAP[i + 19 * 32] = (102 + (player_stamina <= i)) | 10 << 12;
     }
 
     // set stamina blinking color
@@ -115,21 +133,26 @@ static inline void draw_status_bar(void) {
            (player_stamina_recharge_delay & 4) == 0) {
             color = 0x7bde;
         }
-        screen_set_bg_palette_color(10, 12, color);
+        if(screen_widget_changed(&stamina_color_widget, color))
+            screen_set_bg_palette_color(10, 12, color);
     }
 
-    // clear active item area
-    for(u32 x = 20; x < 30; x++)
-        BG3_TILEMAP[x + 18 * 32] = 32;
-
-    // draw active item
-    if(player_active_item.type < ITEM_TYPES) {
-        // copy item palette
-        const struct Item *item = ITEM_S(&player_active_item);
-        screen_load_active_item_palette(item->palette);
-
-        item_draw_icon(&player_active_item, 20, 18, true);
-        item_write(&player_active_item, 0, 21, 18);
+    const u32 active_item_key = player_active_item.type |
+                                player_active_item.count << 8;
+    if(screen_widget_changed(&active_item_widget, active_item_key)) {
+        // clear active item area
+        for(u32 x = 20; x < 30; x++)
+            BG3_TILEMAP[x + 18 * 32] = 32;
+
+        // draw active item
+        if(player_active_item.type < ITEM_TYPES) {
+            // copy item palette
+            const struct Item *item = ITEM_S(&player_active_item);
+            screen_load_active_item_palette(item->palette);
+
+            item_draw_icon(&player_active_item, 20, 18, true);
+            item_write(&player_active_item, 0, 21, 18);
+        }
     }
 }
 
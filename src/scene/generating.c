@@ -0,0 +1,73 @@
+/* Copyright 2023 Vulcalien
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+#include "scene.h"
+
+#include "generator.h"
+#include "screen.h"
+
+// Only one phase of the generation is done per tick: most phases take
+// about a frame. The number of ticks spent generating then depends only
+// on the seed, so replays (which start recording before the generation)
+// stay in sync.
+
+#define BAR_WIDTH (20)
+
+static u8 progress;
+
+THUMB
+static void generating_init(u8 flags) {
+    generate_begin();
+    progress = 0;
+}
+
+THUMB
+static void generating_tick(void) {
+    if(generate_step()) {
+        set_scene(&scene_game, 7);
+        return;
+    }
+
+    // rejected attempts would make the bar go back
+    const u32 new_progress = generate_progress();
+    if(new_progress > progress)
+        progress = new_progress;
+}
+
+THUMB
+static void generating_draw(void) {
+    // clear the screen
+    for(u32 y = 0; y < 20; y++)
+        for(u32 x = 0; x < 30; x++)
+            BG3_TILEMAP[x + y * 32] = 32;
+
+    const u8 bar_x = 5;
+    const u8 bar_y = 10;
+
+    screen_write("GENERATING WORLD", 0, 7, 8);
+
+    const u32 filled = progress * BAR_WIDTH / 100;
+    for(u32 i = 0; i < BAR_WIDTH; i++) {
+        const u16 tile = (i < filled) ? ('=' | 0 << 12) : ('-' | 1 << 12);
+        BG3_TILEMAP[(bar_x + i) + bar_y * 32] = tile;
+    }
+}
+
+const struct Scene scene_generating = {
+    .init = generating_init,
+
+    .tick = generating_tick,
+    .draw = generating_draw
+};
@@ -19,6 +19,7 @@
 #include "screen.h"
 #include "item.h"
 #include "player.h"
+#include "replay.h"
 
 static i32 selected;
 static bool should_render_game = false;
@@ -46,15 +47,15 @@ THUMB
 static void inventory_tick(void) {
     gametime++;
 
-    if(input_press(KEY_B) || input_press(KEY_START))
+    if(game_input_press(KEY_B) || game_input_press(KEY_START))
         set_scene(&scene_game, 1);
 
     if(player_inventory.size == 0)
         return;
 
-    if(input_repeat(KEY_UP))
+    if(game_input_repeat(KEY_UP))
         selected--;
-    if(input_repeat(KEY_DOWN))
+    if(game_input_repeat(KEY_DOWN))
         selected++;
 
     if(selected < 0)
@@ -62,7 +63,7 @@ static void inventory_tick(void) {
     if(selected >= player_inventory.size)
         selected = 0;
 
-    if(input_repeat(KEY_A)) {
+    if(game_input_repeat(KEY_A)) {
         struct item_Data old_active_item = player_active_item;
 
         inventory_remove(&player_inventory, &player_active_item, selected);
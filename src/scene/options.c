@@ -17,6 +17,7 @@
 
 #include "options.h"
 #include "screen.h"
+#include "replay.h"
 
 #define KEEP_INVENTORY (0)
 #define EXIT           (1)
@@ -30,9 +31,9 @@ static void options_init(u8 flags) {
 
 THUMB
 static void options_tick(void) {
-    if(input_repeat(KEY_UP))
+    if(game_input_repeat(KEY_UP))
         selected--;
-    if(input_repeat(KEY_DOWN))
+    if(game_input_repeat(KEY_DOWN))
         selected++;
 
     if(selected < 0)
@@ -40,10 +41,10 @@ static void options_tick(void) {
     else if(selected > EXIT)
         selected = 0;
 
-    if(input_press(KEY_B) || input_press(KEY_START))
+    if(game_input_press(KEY_B) || game_input_press(KEY_START))
         set_scene(&scene_start, 0);
 
-    if(input_press(KEY_A)) {
+    if(game_input_press(KEY_A)) {
         switch(selected) {
             case KEEP_INVENTORY:
                 options.keep_inventory = !options.keep_inventory;
@@ -18,6 +18,7 @@
 #include "screen.h"
 #include "storage.h"
 #include "sound.h"
+#include "replay.h"
 
 static bool ask_overwrite;
 static u8 selected_answer;
@@ -32,17 +33,19 @@ static void pause_init(u8 flags) {
 THUMB
 static void pause_tick(void) {
     if(should_save) {
-        storage_save();
+        // playing a replay must not overwrite the saved game
+        if(replay_mode != REPLAY_PLAYING)
+            storage_save();
         SOUND_PLAY(sound_start);
 
         should_save = false;
         ask_overwrite = false;
     }
 
-    if(input_press(KEY_START))
+    if(game_input_press(KEY_START))
         set_scene(&scene_game, 1);
 
-    if(input_repeat(KEY_A)) {
+    if(game_input_repeat(KEY_A)) {
         if(ask_overwrite) {
             if(selected_answer == 1)
                 ask_overwrite = false;
@@ -56,10 +59,10 @@ static void pause_tick(void) {
         }
     }
 
-    if(input_repeat(KEY_B))
+    if(game_input_repeat(KEY_B))
         ask_overwrite = false;
 
-    if(ask_overwrite && (input_repeat(KEY_LEFT) || input_repeat(KEY_RIGHT)))
+    if(ask_overwrite && (game_input_repeat(KEY_LEFT) || game_input_repeat(KEY_RIGHT)))
         selected_answer ^= 1;
 }
 
@@ -15,11 +15,11 @@
  */
 #include "scene.h"
 
-#include "generator.h"
 #include "furniture.h"
 #include "screen.h"
 #include "storage.h"
 #include "sound.h"
+#include "replay.h"
 
 #define LOAD_GAME   (0)
 #define NEW_GAME    (1)
@@ -42,16 +42,31 @@ static void start_init(u8 flags) {
         storage_srand();
 
         storage_load_options();
+        storage_load_replay();
     } else {
         selected = NEW_GAME;
     }
 }
 
+static inline void start_new_game(void) {
+    gametime = 0;
+    score = 0;
+
+    current_level = 3;
+
+    chest_count = 0;
+    for(u32 i = 0; i < CHEST_LIMIT; i++)
+        chest_inventories[i].size = 0;
+
+    // the generating scene starts the game when the world is ready
+    set_scene(&scene_generating, 1);
+}
+
 THUMB
 static void start_tick(void) {
-    if(input_repeat(KEY_UP))
+    if(game_input_repeat(KEY_UP))
         selected--;
-    if(input_repeat(KEY_DOWN))
+    if(game_input_repeat(KEY_DOWN))
         selected++;
 
     if(selected < (can_load ? LOAD_GAME : NEW_GAME))
@@ -59,7 +74,14 @@ static void start_tick(void) {
     else if(selected > ABOUT)
         selected = (can_load ? LOAD_GAME : NEW_GAME);
 
-    if(input_press(KEY_A) || input_press(KEY_B)) {
+    // SELECT on NEW GAME replays the recorded game, if there is one
+    if(selected == NEW_GAME && game_input_press(KEY_SELECT) && replay_play()) {
+        SOUND_PLAY(sound_start);
+        start_new_game();
+        return;
+    }
+
+    if(game_input_press(KEY_A) || game_input_press(KEY_B)) {
         switch(selected) {
             case LOAD_GAME:
                 SOUND_PLAY(sound_start);
@@ -77,18 +99,8 @@ static void start_tick(void) {
                 // add 'tick_count' to current random seed
                 random_seed(tick_count + random_seed(0));
 
-                generate_levels();
-
-                gametime = 0;
-                score = 0;
-
-                current_level = 3;
-
-                chest_count = 0;
-                for(u32 i = 0; i < CHEST_LIMIT; i++)
-                    chest_inventories[i].size = 0;
-
-                set_scene(&scene_game, 7);
+                replay_record();
+                start_new_game();
                 break;
 
             case OPTIONS:
@@ -16,14 +16,30 @@
 #include "scene.h"
 
 #include "screen.h"
+#include "level.h"
 
 static u8 transition_time;
 static u8 old_level;
 
+// The wipe covers cell (x, y) while
+//     2 * transition_time - 33 < y + wipe_offset[x] < 2 * transition_time
+// so, from a frame to the next, only two rows per column are covered and
+// two are uncovered.
+static const u8 wipe_offset[30] = {
+    0, 2, 0, 3, 1, 3, 2, 4, 2, 5, 3, 5, 4, 6, 4,
+    7, 5, 7, 6, 8, 6, 9, 7, 9, 8, 10, 8, 11, 9, 11
+};
+
+static u8 drawn_time;
+static bool should_redraw;
+static bool should_update_palette;
+
 THUMB
 static void transition_init(u8 flags) {
     transition_time = 0;
     old_level = current_level;
+
+    should_redraw = true;
 }
 
 THUMB
@@ -31,27 +47,75 @@ static void transition_tick(void) {
     gametime++;
 
     transition_time++;
-    if(transition_time == 17)
-        scene_game.init(3);
-    else if(transition_time == 31)
+    if(transition_time == 17) {
+        // The loading is completed by the next ticks. The first step
+        // loads the visible rows, so that the level can already be drawn
+        // where the wipe uncovers it.
+        scene_game.init(3 | 8);
+        level_load_step();
+
+        // the game scene clears the screen and its palette must change
+        should_redraw = true;
+        should_update_palette = true;
+    } else if(transition_time == 31) {
         set_scene(&scene_game, 1);
+    } else if(transition_time > 17) {
+        level_load_step();
+    }
+}
+
+static inline void draw_wipe_cell(u32 x, i32 y, i32 first, i32 last) {
+    if(y < 0 || y >= 20)
+        return;
+
+    u16 ydraw = old_level < current_level ? y : 19 - y;
+    if(y >= first && y <= last)
+        BG3_TILEMAP[x + ydraw * 32] = 32;
+    else if(ydraw < 18)
+        BG3_TILEMAP[x + ydraw * 32] = 0;
 }
 
 IWRAM_SECTION
 static void transition_draw(void) {
+    // this runs right after VBlank starts
+    if(should_update_palette) {
+        screen_update_level_specific();
+        should_update_palette = false;
+    }
+
     scene_game.draw();
 
-    for(u32 y = 0; y < 20; y++) {
-        for(u32 x = 0; x < 30; x++) {
-            i32 dd = (y + x % 2 * 2 + x / 3) - transition_time * 2;
+    // after a skipped frame, all cells have to be drawn again
+    if(transition_time != drawn_time + 1)
+        should_redraw = true;
+    drawn_time = transition_time;
+
+    // rows of the status bar, which the game scene draws every frame
+    const i32 bar0 = old_level < current_level ? 18 : 0;
+    const i32 bar1 = bar0 + 1;
 
-            u16 ydraw = old_level < current_level ? y : 19 - y;
-            if(dd > -33 && dd < 0)
-                BG3_TILEMAP[x + ydraw * 32] = 32;
-            else if(ydraw < 18)
-                BG3_TILEMAP[x + ydraw * 32] = 0;
+    for(u32 x = 0; x < 30; x++) {
+        // covered rows
+        const i32 first = transition_time * 2 - 32 - wipe_offset[x];
+        const i32 last  = transition_time * 2 - 1  - wipe_offset[x];
+
+        if(should_redraw) {
+            for(i32 y = 0; y < 20; y++)
+                draw_wipe_cell(x, y, first, last);
+        } else {
+            draw_wipe_cell(x, first - 2, first, last);
+            draw_wipe_cell(x, first - 1, first, last);
+            draw_wipe_cell(x, last - 1,  first, last);
+            draw_wipe_cell(x, last,      first, last);
+
+            draw_wipe_cell(x, bar0, first, last);
+            draw_wipe_cell(x, bar1, first, last);
         }
     }
+    should_redraw = false;
+
+    // the status bar may have been covered
+    screen_invalidate_widgets();
 }
 
 const struct Scene scene_transition = {
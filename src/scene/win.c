@@ -16,6 +16,7 @@
 #include "scene.h"
 
 #include "screen.h"
+#include "replay.h"
 
 static u8 win_time;
 
@@ -28,7 +29,7 @@ THUMB
 static void win_tick(void) {
     win_time++;
     if(win_time > 60) {
-        if(input_press(KEY_A) || input_press(KEY_B))
+        if(game_input_press(KEY_A) || game_input_press(KEY_B))
             set_scene(&scene_game, 1);
     }
 }
@@ -36,6 +36,46 @@
 #define BG_PALETTE  ((vu16 *) 0x05000000)
 #define SPR_PALETTE ((vu16 *) 0x05000200)
 
+#define INTERRUPT_MASTER *((vu16 *) 0x04000208)
+
+#define DMA0_SOURCE  *((vu32 *) 0x040000b0)
+#define DMA0_DEST    *((vu32 *) 0x040000b4)
+#define DMA0_CONTROL *((vu32 *) 0x040000b8)
+
+// enable, 32-bit transfer, start immediately
+#define DMA_UPLOAD_CONTROL (1 << 31 | 1 << 26)
+
+#define UPLOAD_QUEUE_SIZE (8)
+
+static struct Upload {
+    volatile void *dest;
+    const void *src;
+    u32 n;
+} upload_queue[UPLOAD_QUEUE_SIZE];
+static u32 upload_count = 0;
+
+#define OAM ((vu32 *) 0x07000000)
+
+// attribute 0 of a hidden sprite
+#define OAM_HIDDEN (1 << 9)
+
+// Shadow of OAM: each sprite takes two words, attributes 0 and 1 in the
+// first and attribute 2 in the second (attribute 3 is left to 0, as no
+// sprite is affine). Only the changed range is uploaded.
+static u32 oam_shadow[SPRITE_COUNT * 2];
+static u32 oam_dirty_start = SPRITE_COUNT;
+static u32 oam_dirty_end = 0;
+
+#define BG3_VISIBLE_WORDS (32 * 20 / 2)
+
+u32 screen_bg3_shadow[32 * 32 / 2];
+
+// BG3 as it is in VRAM and the indexes of the words that changed in the
+// last commit: they are written to VRAM by the VBlank ISR
+static u32 bg3_committed[BG3_VISIBLE_WORDS];
+static u16 bg3_changes[BG3_VISIBLE_WORDS];
+static vu32 bg3_change_count = 0;
+
 #define LOAD_TILESET(charblock, offset, tileset)      \
     memory_copy_32(                                   \
         display_charblock(charblock) + (offset) * 16, \
@@ -146,7 +186,16 @@ void screen_init(void) {
         for(u32 x = 0; x < 30; x++)
             BG3_TILEMAP[x + y * 32] = 32;
 
+    memory_copy_32(
+        display_screenblock(19), screen_bg3_shadow, sizeof(bg3_committed)
+    );
+    memory_copy_32(
+        bg3_committed, screen_bg3_shadow, sizeof(bg3_committed)
+    );
+
     sprite_hide(-1);
+    for(u32 i = 0; i < SPRITE_COUNT; i++)
+        oam_shadow[i * 2] = OAM_HIDDEN;
 
     // disable forced blank
     display_force_blank(false);
@@ -207,6 +256,138 @@ void screen_draw_frame(const char *title, u32 x, u32 y, u32 w, u32 h) {
     screen_write(title, 10, x + 1, y);
 }
 
+void screen_queue_upload(volatile void *dest, const void *src, u32 n) {
+    // the VBlank ISR empties the queue: block it while adding an upload
+    const u16 ime = INTERRUPT_MASTER;
+    INTERRUPT_MASTER = 0;
+
+    if(upload_count < UPLOAD_QUEUE_SIZE) {
+        upload_queue[upload_count++] = (struct Upload) {
+            .dest = dest,
+            .src  = src,
+            .n    = n
+        };
+    } else {
+        memory_copy_32(dest, src, n);
+    }
+
+    INTERRUPT_MASTER = ime;
+}
+
+IWRAM_SECTION
+void screen_commit_bg3(void) {
+    // the changes of the previous commit are not in VRAM yet
+    if(bg3_change_count != 0)
+        return;
+
+    u32 count = 0;
+    for(u32 i = 0; i < BG3_VISIBLE_WORDS; i++) {
+        const u32 word = screen_bg3_shadow[i];
+        if(word != bg3_committed[i]) {
+            bg3_committed[i] = word;
+            bg3_changes[count++] = i;
+        }
+    }
+    bg3_change_count = count;
+}
+
+IWRAM_SECTION
+void screen_vblank(void) {
+    // DMA0 is used so that the uploads cannot interfere with a DMA3
+    // transfer interrupted by the VBlank ISR
+    for(u32 i = 0; i < upload_count; i++) {
+        const struct Upload *upload = &upload_queue[i];
+
+        DMA0_SOURCE  = (u32) upload->src;
+        DMA0_DEST    = (u32) upload->dest;
+        DMA0_CONTROL = DMA_UPLOAD_CONTROL | (upload->n / 4);
+    }
+    upload_count = 0;
+
+    const u32 bg3_count = bg3_change_count;
+    if(bg3_count != 0) {
+        vu32 *bg3_vram = (vu32 *) display_screenblock(19);
+        for(u32 i = 0; i < bg3_count; i++) {
+            const u16 word = bg3_changes[i];
+            bg3_vram[word] = bg3_committed[word];
+        }
+        bg3_change_count = 0;
+    }
+}
+
+static inline void set_oam_entry(u32 id, u32 attr01, u32 attr2) {
+    u32 *entry = &oam_shadow[id * 2];
+    if(entry[0] == attr01 && entry[1] == attr2)
+        return;
+
+    entry[0] = attr01;
+    entry[1] = attr2;
+
+    if(id < oam_dirty_start)
+        oam_dirty_start = id;
+    if(id >= oam_dirty_end)
+        oam_dirty_end = id + 1;
+}
+
+IWRAM_SECTION
+void screen_sprite_config(u32 id, const struct Sprite *sprite) {
+    const u32 shape = sprite->size >> 2;
+    const u32 size  = sprite->size & 3;
+
+    const u32 attr0 = (sprite->y & 0xff)    |
+                      sprite->mode   << 10  |
+                      shape          << 14;
+    const u32 attr1 = (sprite->x & 0x1ff)   |
+                      sprite->flip   << 12  |
+                      size           << 14;
+    const u32 attr2 = (sprite->tile & 0x3ff) |
+                      sprite->priority << 10 |
+                      sprite->palette  << 12;
+
+    set_oam_entry(id, attr0 | attr1 << 16, attr2);
+}
+
+IWRAM_SECTION
+void screen_sprite_hide_range(u32 start, u32 end) {
+    for(u32 id = start; id < end; id++) {
+        const u32 *entry = &oam_shadow[id * 2];
+        set_oam_entry(
+            id, (entry[0] & 0xffff0000) | OAM_HIDDEN, entry[1]
+        );
+    }
+}
+
+void screen_commit_sprites(void) {
+    if(oam_dirty_start >= oam_dirty_end)
+        return;
+
+    screen_queue_upload(
+        OAM + oam_dirty_start * 2,
+        &oam_shadow[oam_dirty_start * 2],
+        (oam_dirty_end - oam_dirty_start) * 8
+    );
+
+    oam_dirty_start = SPRITE_COUNT;
+    oam_dirty_end = 0;
+}
+
+// widgets are valid if their generation is the current one
+static u32 widget_generation = 1;
+
+IWRAM_SECTION
+bool screen_widget_changed(struct screen_Widget *widget, u32 key) {
+    if(widget->key == key && widget->generation == widget_generation)
+        return false;
+
+    widget->key = key;
+    widget->generation = widget_generation;
+    return true;
+}
+
+void screen_invalidate_widgets(void) {
+    widget_generation++;
+}
+
 static inline u32 ticks_to_seconds(u32 ticks) {
     // refresh time:    280_896    cycles = 4389   * 64 cycles
     // clock frequency: 16_777_216 Hz     = 262144 * 64 Hz
@@ -23,6 +23,7 @@
 #include "item.h"
 #include "player.h"
 #include "air-wizard.h"
+#include "replay.h"
 
 /*
          Storage Layout
@@ -49,7 +50,7 @@
     |                      |
     |                      |
     |       Tile IDs       |
-    |                      |
+    |     (and replay)     |
     |             36.75 KB |
     +----------------------+ 2 0000
 
@@ -75,7 +76,15 @@
 
       1 B - keep inventory option
 
-     96 B - padding
+      1 B - padding
+      2 B - replay offset (in bank 1, 0 if absent)
+     93 B - padding
+
+* Replay (stored in the space left after the tile IDs):
+      4 B - random seed
+      1 B - keep inventory option
+      2 B - length of the stream (n)
+  2 * n B - stream
 */
 
 #define FLASH_ROM ((vu8 *) 0x0e000000)
@@ -83,6 +92,9 @@
 #define LEVEL_COUNT (sizeof(levels) / sizeof(struct Level))
 #define BYTES_PER_ITEM 3
 
+#define REPLAY_OFFSET_POSITION (0x01a1)
+#define REPLAY_HEADER_SIZE (7)
+
 THUMB
 bool storage_check(void) {
     backup_set_bank(0);
@@ -127,6 +139,32 @@ void storage_load_options(void) {
     options.keep_inventory = backup_read_byte(0x01a0);
 }
 
+THUMB
+void storage_load_replay(void) {
+    backup_set_bank(0);
+
+    u16 offset;
+    backup_read(REPLAY_OFFSET_POSITION, &offset, 2);
+
+    // older saves have no replay: the offset is in the padding
+    replay_length = 0;
+    if(offset == 0)
+        return;
+
+    backup_set_bank(1);
+
+    u16 length;
+    backup_read(offset, &replay_seed, 4);
+    replay_keep_inventory = backup_read_byte(offset + 4);
+    backup_read(offset + 5, &length, 2);
+
+    if(length > REPLAY_STREAM_SIZE)
+        return;
+
+    backup_read(offset + REPLAY_HEADER_SIZE, replay_stream, length * 2);
+    replay_length = length;
+}
+
 /* ================================================================== */
 /*                            storage_load                            */
 /* ================================================================== */
@@ -351,9 +389,12 @@ static INLINE void store_header(void) {
     write_8(offset, options.keep_inventory);
     offset += 1;
 
-    // write padding
-    while(offset < 0x0200)
+    // write padding, skipping the replay offset
+    while(offset < 0x0200) {
+        if(offset == REPLAY_OFFSET_POSITION)
+            offset += 2;
         write_8(offset++, 0);
+    }
 }
 
 static INLINE void store_chests(void) {
@@ -404,7 +445,7 @@ static INLINE void store_tile_data(void) {
     }
 }
 
-static INLINE void store_tile_ids(void) {
+static INLINE u16 store_tile_ids(void) {
     u16 offset = 0x6d00;
     for(u32 i = 0; i < LEVEL_COUNT; i++) {
         struct Level *level = &levels[i];
@@ -426,10 +467,42 @@ static INLINE void store_tile_ids(void) {
             }
         }
     }
+    return offset;
+}
+
+static INLINE u16 store_replay(u16 offset) {
+    // if the tile IDs filled bank 1, the offset wrapped around to 0
+    const u32 space = (offset == 0) ? 0 : 0x10000 - offset;
+
+    u16 replay_offset = 0;
+    if(space >= REPLAY_HEADER_SIZE) {
+        replay_offset = offset;
+
+        // if the stream does not fit, store only its beginning
+        u32 length = replay_length;
+        if(length > (space - REPLAY_HEADER_SIZE) / 2)
+            length = (space - REPLAY_HEADER_SIZE) / 2;
+
+        write_32(offset, replay_seed);
+        offset += 4;
+
+        write_8(offset, replay_keep_inventory);
+        offset += 1;
+
+        write_16(offset, length);
+        offset += 2;
+
+        for(u32 i = 0; i < length; i++) {
+            write_16(offset, replay_stream[i]);
+            offset += 2;
+        }
+    }
 
     // write padding
     while(offset != 0x0000)
         write_8(offset++, 0);
+
+    return replay_offset;
 }
 
 THUMB
@@ -442,8 +515,12 @@ void storage_save(void) {
     store_chests();
     store_entities();
     store_tile_data();
-    store_tile_ids();
 
+    const u16 tile_ids_end = store_tile_ids();
+    const u16 replay_offset = store_replay(tile_ids_end);
+
+    // the replay offset is only known now: write it before the checksum
     backup_set_bank(0);
+    write_16(REPLAY_OFFSET_POSITION, replay_offset);
     backup_write(0x0004, &checksum, 4);
 }
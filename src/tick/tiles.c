@@ -129,3 +129,41 @@ static inline void tick_tile(struct Level *level, u32 xt, u32 yt) {
 }
 
 #undef CALL
+
+static inline bool is_neighbor_tile(struct Level *level, u32 xt, u32 yt,
+                                    u8 tile) {
+    return LEVEL_GET_TILE(level, xt - 1, yt) == tile ||
+           LEVEL_GET_TILE(level, xt + 1, yt) == tile ||
+           LEVEL_GET_TILE(level, xt, yt - 1) == tile ||
+           LEVEL_GET_TILE(level, xt, yt + 1) == tile;
+}
+
+// Returns true if 'tick_tile' could change the level at the given tile.
+static inline bool is_tile_active(struct Level *level, u32 xt, u32 yt) {
+    switch(LEVEL_GET_TILE(level, xt, yt)) {
+        case ROCK_TILE:
+        case TREE_TILE:
+        case SAND_TILE:
+        case CACTUS_TILE:
+        case HARD_ROCK_TILE:
+            return LEVEL_GET_DATA(level, xt, yt) != 0;
+
+        case GRASS_TILE:
+        case FLOWER_TILE:
+            return is_neighbor_tile(level, xt, yt, DIRT_TILE);
+
+        case LIQUID_TILE:
+            return is_neighbor_tile(level, xt, yt, HOLE_TILE);
+
+        case TREE_SAPLING_TILE:
+        case CACTUS_SAPLING_TILE:
+            return true;
+
+        case FARMLAND_TILE:
+            return LEVEL_GET_DATA(level, xt, yt) < 5;
+
+        case WHEAT_TILE:
+            return LEVEL_GET_DATA(level, xt, yt) < 50;
+    }
+    return false;
+}